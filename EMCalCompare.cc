@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Main file of the EMCalCompare application. It compares the output trees of   //
+//  two runs of EMCalorimeter event by event, matching the entries by their      //
+//  event number, so the order in which the threads wrote them does not matter.  //
+//  All the leaves of the first tree are compared with those of the second, and  //
+//  the program fails if any of them differs. It is used to check that the       //
+//  events do not depend on the number of threads.                               //
+//                                                                               //
+//  Usage: EMCalCompare <file A> <file B> [ option=value ... ]                   //
+//                                                                               //
+//  Options:                                                                     //
+//    tree      : name of the tree to compare ( DecayTree )                      //
+//    tolerance : relative difference allowed between two values ( 0 )           //
+//    print     : maximum number of differences printed ( 10 )                   //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "TFile.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+#include "TTree.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+//_______________________________________________________________________________
+// Opens the file < name > and gets the tree < treeName > from it. Returns zero if
+// any of them is not found.
+static TTree* GetTree( const char *name, const std::string &treeName ) {
+
+  TFile *file = TFile::Open( name );
+  if ( !file || file -> IsZombie() ) {
+    std::cout << "ERROR: Unable to open file <" << name << ">" << std::endl;
+    return 0;
+  }
+
+  TTree *tree = 0;
+  file -> GetObject( treeName.c_str(), tree );
+  if ( !tree )
+    std::cout << "ERROR: Tree <" << treeName << "> not found in <" << name << ">" << std::endl;
+
+  return tree;
+}
+
+//_______________________________________________________________________________
+
+int main( int argc, char **argv ) {
+
+  if ( argc < 3 ) {
+    std::cout << "Usage: " << argv[ 0 ]
+	      << " <file A> <file B> [ option=value ... ]" << std::endl;
+    return 1;
+  }
+
+  // Parses the options
+  std::string treeName  = "DecayTree";
+  double      tolerance = 0;
+  long        maxPrint  = 10;
+  for ( int iarg = 3; iarg < argc; iarg++ ) {
+
+    std::string arg = argv[ iarg ];
+    size_t      pos = arg.find( '=' );
+    if ( pos == std::string::npos ) {
+      std::cout << "ERROR: Option <" << arg << "> must be given as option=value" << std::endl;
+      return 1;
+    }
+
+    std::string key = arg.substr( 0, pos ), value = arg.substr( pos + 1 );
+    if      ( key == "tree"      ) treeName  = value;
+    else if ( key == "tolerance" ) tolerance = std::atof( value.c_str() );
+    else if ( key == "print"     ) maxPrint  = std::atol( value.c_str() );
+    else {
+      std::cout << "ERROR: Unknown option <" << key << ">" << std::endl;
+      return 1;
+    }
+  }
+
+  TTree *treeA = GetTree( argv[ 1 ], treeName );
+  TTree *treeB = GetTree( argv[ 2 ], treeName );
+  if ( !treeA || !treeB )
+    return 1;
+
+  Long64_t nevts = treeA -> GetEntries();
+  if ( treeB -> GetEntries() != nevts ) {
+    std::cout << "ERROR: The trees have " << nevts << " and " << treeB -> GetEntries()
+	      << " entries" << std::endl;
+    return 1;
+  }
+
+  // Pairs the leaves of both trees by their name
+  std::vector<TLeaf*> leavesA, leavesB;
+  TObjArray *leaves = treeA -> GetListOfLeaves();
+  for ( int ileaf = 0; ileaf < leaves -> GetEntries(); ileaf++ ) {
+
+    TLeaf *leafA = static_cast<TLeaf*>( leaves -> At( ileaf ) );
+    TLeaf *leafB = treeB -> GetLeaf( leafA -> GetName() );
+    if ( !leafB ) {
+      std::cout << "ERROR: Leaf <" << leafA -> GetName() << "> not found in <"
+		<< argv[ 2 ] << ">" << std::endl;
+      return 1;
+    }
+    leavesA.push_back( leafA );
+    leavesB.push_back( leafB );
+  }
+
+  TLeaf *evtLeaf = treeA -> GetLeaf( "EventNumber" );
+  if ( !evtLeaf ) {
+    std::cout << "ERROR: Leaf <EventNumber> not found in <" << argv[ 1 ] << ">" << std::endl;
+    return 1;
+  }
+  treeB -> BuildIndex( "EventNumber" );
+
+  // Loops over the events of the first tree, getting the event with the same number
+  // from the second one
+  long ndiff = 0;
+  for ( Long64_t ievt = 0; ievt < nevts; ievt++ ) {
+
+    treeA -> GetEntry( ievt );
+    int evtNb = int( evtLeaf -> GetValue() );
+
+    if ( treeB -> GetEntryWithIndex( evtNb ) < 0 ) {
+      if ( ndiff++ < maxPrint )
+	std::cout << " Event " << evtNb << " not found in <" << argv[ 2 ] << ">" << std::endl;
+      continue;
+    }
+
+    for ( size_t ileaf = 0; ileaf < leavesA.size(); ileaf++ ) {
+
+      TLeaf *leafA = leavesA[ ileaf ], *leafB = leavesB[ ileaf ];
+
+      int  n     = leafA -> GetLen();
+      bool equal = ( leafB -> GetLen() == n );
+      for ( int i = 0; equal && i < n; i++ ) {
+	double a = leafA -> GetValue( i ), b = leafB -> GetValue( i );
+	equal = ( a == b || std::fabs( a - b ) <= tolerance*std::fabs( a ) );
+      }
+
+      if ( !equal ) {
+	if ( ndiff++ < maxPrint )
+	  std::cout << " Event " << evtNb << " differs in leaf <"
+		    << leafA -> GetName() << ">" << std::endl;
+	break;
+      }
+    }
+  }
+
+  std::cout << " Compared " << nevts << " events of tree <" << treeName << ">: "
+	    << ndiff << " differences" << std::endl;
+
+  return ndiff > 0;
+}
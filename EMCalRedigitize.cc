@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Main file of the EMCalRedigitize application. It reads the step hits written //
+//  by EMCalorimeter ( see /EMCal/run/recordSteps ) and passes them through a    //
+//  detector response model, writing the energy measured in each module and      //
+//  event. The response can be studied this way without simulating again the     //
+//  showers.                                                                     //
+//                                                                               //
+//  Usage: EMCalRedigitize <input file> <output file> [ option=value ... ]       //
+//                                                                               //
+//  Options:                                                                     //
+//    tree      : name of the tree with the step hits ( DecayTree_Steps )        //
+//    gate      : integration gate in ns, starting at zero. If zero, all the     //
+//                steps are integrated ( 0 )                                     //
+//    yield     : photoelectrons per MeV. If zero the photostatistics is not     //
+//                applied ( 0 )                                                  //
+//    noise     : width of the gaussian noise of each module in MeV ( 0 )        //
+//    threshold : energy in MeV below which a module is set to zero ( 0 )        //
+//    sgv       : whether the steps in the shower-generator volumes are          //
+//                integrated ( 0 )                                               //
+//    seed      : seed of the random number generator ( 4357 )                   //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "TFile.h"
+#include "TRandom3.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+//_______________________________________________________________________________
+// Parameters of the response of the detector
+struct ResponseModel {
+
+  ResponseModel() :
+    Gate( 0 ), LightYield( 0 ), Noise( 0 ), Threshold( 0 ), UseSGV( false ) { }
+
+  double Gate;
+  double LightYield;
+  double Noise;
+  double Threshold;
+  bool   UseSGV;
+};
+
+//_______________________________________________________________________________
+// Applies the response model to the energy deposited in one module
+static double Digitize( double edep, const ResponseModel &model, TRandom3 &rndm ) {
+
+  double energy = edep;
+
+  if ( model.LightYield > 0 )
+    energy = rndm.Poisson( edep*model.LightYield )/model.LightYield;
+
+  if ( model.Noise > 0 )
+    energy += rndm.Gaus( 0, model.Noise );
+
+  return energy > model.Threshold ? energy : 0;
+}
+
+//_______________________________________________________________________________
+
+int main( int argc, char **argv ) {
+
+  if ( argc < 3 ) {
+    std::cout << "Usage: " << argv[ 0 ]
+	      << " <input file> <output file> [ option=value ... ]" << std::endl;
+    return 1;
+  }
+
+  // Parses the options of the response model
+  ResponseModel model;
+  std::string   treeName = "DecayTree_Steps";
+  unsigned int  seed     = 4357;
+  for ( int iarg = 3; iarg < argc; iarg++ ) {
+
+    std::string arg = argv[ iarg ];
+    size_t      pos = arg.find( '=' );
+    if ( pos == std::string::npos ) {
+      std::cout << "ERROR: Option <" << arg << "> must be given as option=value" << std::endl;
+      return 1;
+    }
+
+    std::string key = arg.substr( 0, pos ), value = arg.substr( pos + 1 );
+    if      ( key == "tree"      ) treeName         = value;
+    else if ( key == "gate"      ) model.Gate       = std::atof( value.c_str() );
+    else if ( key == "yield"     ) model.LightYield = std::atof( value.c_str() );
+    else if ( key == "noise"     ) model.Noise      = std::atof( value.c_str() );
+    else if ( key == "threshold" ) model.Threshold  = std::atof( value.c_str() );
+    else if ( key == "sgv"       ) model.UseSGV     = std::atoi( value.c_str() );
+    else if ( key == "seed"      ) seed             = std::atoi( value.c_str() );
+    else {
+      std::cout << "ERROR: Unknown option <" << key << ">" << std::endl;
+      return 1;
+    }
+  }
+
+  // Gets the tree with the step hits
+  TFile *ifile = TFile::Open( argv[ 1 ] );
+  if ( !ifile || ifile -> IsZombie() ) {
+    std::cout << "ERROR: Unable to open file <" << argv[ 1 ] << ">" << std::endl;
+    return 1;
+  }
+
+  TTree *itree = 0;
+  ifile -> GetObject( treeName.c_str(), itree );
+  if ( !itree ) {
+    std::cout << "ERROR: Tree <" << treeName << "> not found in <"
+	      << argv[ 1 ] << ">" << std::endl;
+    return 1;
+  }
+
+  if ( itree -> GetEntries() == 0 ) {
+    std::cout << "ERROR: Tree <" << treeName << "> in <" << argv[ 1 ]
+	      << "> has no entries" << std::endl;
+    return 1;
+  }
+
+  // The buffers are allocated for the largest event. Only the branches used by the
+  // response model are read. If no event has steps the maximum of the modules is
+  // the lowest double, so it is not converted.
+  Double_t maxModule = itree -> GetMaximum( "Module" );
+  size_t   maxSteps  = itree -> GetMaximum( "nSteps" );
+  size_t   nmodules  = maxModule < 0 ? 0 : size_t( maxModule ) + 1;
+
+  Int_t                evtNb, nsteps;
+  std::vector<Int_t>   module( maxSteps + 1 );
+  std::vector<Char_t>  sgv( maxSteps + 1 );
+  std::vector<Float_t> time( maxSteps + 1 ), energy( maxSteps + 1 );
+
+  itree -> SetBranchStatus( "*", 0 );
+  itree -> SetBranchStatus( "EventNumber", 1 );
+  itree -> SetBranchStatus( "nSteps", 1 );
+  itree -> SetBranchStatus( "Module", 1 );
+  itree -> SetBranchStatus( "SGV", 1 );
+  itree -> SetBranchStatus( "Time", 1 );
+  itree -> SetBranchStatus( "Energy", 1 );
+  itree -> SetBranchAddress( "EventNumber", &evtNb );
+  itree -> SetBranchAddress( "nSteps", &nsteps );
+  itree -> SetBranchAddress( "Module", &module[ 0 ] );
+  itree -> SetBranchAddress( "SGV", &sgv[ 0 ] );
+  itree -> SetBranchAddress( "Time", &time[ 0 ] );
+  itree -> SetBranchAddress( "Energy", &energy[ 0 ] );
+
+  // Creates the output tree
+  TFile *ofile = TFile::Open( argv[ 2 ], "RECREATE" );
+  if ( !ofile || ofile -> IsZombie() ) {
+    std::cout << "ERROR: Unable to create file <" << argv[ 2 ] << ">" << std::endl;
+    return 1;
+  }
+
+  Int_t                 nmod = nmodules;
+  Double_t              totalEnergy;
+  std::vector<Double_t> moduleEnergy( nmodules + 1 );
+
+  TTree *otree = new TTree( "DigiTree", "DigiTree" );
+  otree -> Branch( "EventNumber", &evtNb, "EventNumber/I" );
+  otree -> Branch( "nModules", &nmod, "nModules/I" );
+  otree -> Branch( "Energy", &moduleEnergy[ 0 ], "Energy[nModules]/D" );
+  otree -> Branch( "TotalEnergy", &totalEnergy, "TotalEnergy/D" );
+
+  // Loops over the events, integrating the steps of each module and applying the
+  // response to the modules with energy deposited
+  TRandom3 rndm( seed );
+
+  Long64_t nevts = itree -> GetEntries();
+  for ( Long64_t ievt = 0; ievt < nevts; ievt++ ) {
+
+    itree -> GetEntry( ievt );
+
+    std::fill( moduleEnergy.begin(), moduleEnergy.end(), 0 );
+
+    for ( Int_t istep = 0; istep < nsteps; istep++ ) {
+
+      if ( sgv[ istep ] && !model.UseSGV )
+	continue;
+      if ( model.Gate > 0 && ( time[ istep ] < 0 || time[ istep ] > model.Gate ) )
+	continue;
+
+      moduleEnergy[ module[ istep ] ] += energy[ istep ];
+    }
+
+    totalEnergy = 0;
+    for ( size_t imod = 0; imod < nmodules; imod++ ) {
+
+      if ( moduleEnergy[ imod ] > 0 || model.Noise > 0 )
+	moduleEnergy[ imod ] = Digitize( moduleEnergy[ imod ], model, rndm );
+
+      totalEnergy += moduleEnergy[ imod ];
+    }
+
+    otree -> Fill();
+  }
+
+  std::cout << " Processed " << nevts << " events from tree <" << treeName << ">" << std::endl;
+  std::cout << " Output written to <" << argv[ 2 ] << ">" << std::endl;
+
+  otree -> Write();
+  ofile -> Close();
+  ifile -> Close();
+
+  return 0;
+}
@@ -14,6 +14,13 @@
 //  list, detector construction and user initialization are declared here, as    //
 //  well as the UI messenger.                                                    //
 //                                                                               //
+//  Usage: EMCalorimeter [-m type] [-t threads] [-g grainsize] [macro]           //
+//                                                                               //
+//  The type of run manager ( serial, mt, tasking or tbb ), the number of        //
+//  threads and the grain size of the tasks can also be given through the        //
+//  environment variables EMCAL_RUN_MANAGER, EMCAL_NTHREADS and                  //
+//  EMCAL_TASK_GRAINSIZE. The options override them.                             //
+//                                                                               //
 // ----------------------------------------------------------------------------- //
 ///////////////////////////////////////////////////////////////////////////////////
 
@@ -21,9 +28,22 @@
 #include "EMCalDetectorConstruction.hh"
 #include "EMCalActionInitialization.hh"
 #include "EMCalPhysicsList.hh"
+#include "EMCalWorkerInitialization.hh"
+
+#include "G4Version.hh"
+
+// The type of run manager is selected at run time since Geant4 10.7
+#if G4VERSION_NUMBER >= 1070
+#include "G4RunManagerFactory.hh"
+#ifdef G4MULTITHREADED
+#include "G4TaskRunManager.hh"
+#endif
+#endif
 
 #ifdef G4MULTITHREADED
+#include "EMCalMTRunManager.hh"
 #include "G4MTRunManager.hh"
+#include "TROOT.h"
 #else
 #include "G4RunManager.hh"
 #endif
@@ -41,28 +61,105 @@
 
 #include "Randomize.hh"
 
+#include <cstdlib>
 #include <ctime>
 
 
+//_______________________________________________________________________________
+// Returns the value of the environment variable < name >, or < def > if it is not set
+static G4String GetEnvironment( const char *name, const char *def = "" ) {
+
+  const char *value = std::getenv( name );
+
+  return value ? value : def;
+}
+
 //_______________________________________________________________________________
 
 int main( int argc, char **argv ) {
 
-  // Detects interactive mode ( if no arguments)  and defines UI session
+  // Reads the options from the environment and the command line. The last argument
+  // which is not an option is the macro to execute.
+  G4String macro;
+  G4String rmName    = GetEnvironment( "EMCAL_RUN_MANAGER" );
+  G4int    nthreads  = std::atoi( GetEnvironment( "EMCAL_NTHREADS", "0" ).data() );
+  G4int    grainsize = std::atoi( GetEnvironment( "EMCAL_TASK_GRAINSIZE", "0" ).data() );
+  for ( G4int iarg = 1; iarg < argc; iarg++ ) {
+
+    G4String arg = argv[ iarg ];
+
+    if      ( arg == "-m" && iarg + 1 < argc )
+      rmName = argv[ ++iarg ];
+    else if ( arg == "-t" && iarg + 1 < argc )
+      nthreads = std::atoi( argv[ ++iarg ] );
+    else if ( arg == "-g" && iarg + 1 < argc )
+      grainsize = std::atoi( argv[ ++iarg ] );
+    else
+      macro = arg;
+  }
+
+  // Detects interactive mode ( if no macro ) and defines UI session
   G4UIExecutive *ui( 0 );
-  if ( argc == 1 ) {
+  if ( macro.empty() ) {
     ui = new G4UIExecutive( argc, argv );
   }
 
-  // Sets the Random engine. The seed is set from the time library
+  // Sets the Random engine. The seed is set from the time library. The seed of each
+  // run is taken from it, unless it is set with < /EMCal/run/setSeed >.
   G4Random::setTheEngine( new CLHEP::RanecuEngine );
   G4Random::setTheSeed( time( 0 ) );
 
-  // Constructs the default run manager
+  // In multithreaded mode each worker writes its own Root file, so the thread safety
+  // of Root has to be enabled before creating the run manager
 #ifdef G4MULTITHREADED
-  G4MTRunManager *runManager = new G4MTRunManager;
+  ROOT::EnableThreadSafety();
+#endif
+
+  // Constructs the run manager. If no type is given, the multithreaded run manager
+  // of the application is used, unless the type of Geant4 is set through the
+  // variable G4RUN_MANAGER_TYPE. With the task based run managers the events are
+  // processed as tasks in a thread pool.
+#if G4VERSION_NUMBER >= 1070
+  // The multithreaded run manager is replaced by that of the application, which
+  // sets the size of the chunks of events given to the workers and shares the
+  // sub-events among them.
+  if ( rmName.empty() )
+    rmName = GetEnvironment( "G4RUN_MANAGER_TYPE" );
+  G4RunManagerType rmType = G4RunManagerType::Default;
+  if ( !rmName.empty() )
+    rmType = G4RunManagerFactory::GetType( rmName );
+#ifdef G4MULTITHREADED
+  else
+    rmType = G4RunManagerType::MT;
+#endif
+  G4RunManager *runManager;
+#ifdef G4MULTITHREADED
+  if ( rmType == G4RunManagerType::MT || rmType == G4RunManagerType::MTOnly ) {
+    runManager = new EMCalMTRunManager;
+    if ( nthreads > 0 )
+      runManager -> SetNumberOfThreads( nthreads );
+  }
+  else
+    runManager = G4RunManagerFactory::CreateRunManager( rmType, false, nthreads );
+#else
+  runManager = G4RunManagerFactory::CreateRunManager( rmType, false, nthreads );
+#endif
+#ifdef G4MULTITHREADED
+  G4TaskRunManager *taskManager = dynamic_cast<G4TaskRunManager*>( runManager );
+  if ( taskManager && grainsize > 0 )
+    taskManager -> SetGrainsize( grainsize );
+#endif
+#else
+  if ( !rmName.empty() || grainsize > 0 )
+    G4cout << "WARNING: The type of run manager and the grain size of the tasks can "
+	   << "only be selected since Geant4 10.7" << G4endl;
+#ifdef G4MULTITHREADED
+  G4MTRunManager *runManager = new EMCalMTRunManager;
+  if ( nthreads > 0 )
+    runManager -> SetNumberOfThreads( nthreads );
 #else
   G4RunManager *runManager = new G4RunManager;
+#endif
 #endif
 
   // Get the pointer to the User Interface manager
@@ -81,6 +178,10 @@ int main( int argc, char **argv ) {
     
   // User action initialization
   runManager -> SetUserInitialization( new EMCalActionInitialization );
+
+  // Initialization of the worker threads, which pins them to the processors
+  if ( runManager -> GetRunManagerType() == G4RunManager::masterRM )
+    runManager -> SetUserInitialization( new EMCalWorkerInitialization );
   
   // Initializes visualization
   G4VisManager *visManager = new G4VisExecutive;
@@ -90,8 +191,7 @@ int main( int argc, char **argv ) {
   if ( ! ui ) { 
     // Batch mode
     G4String command = "/control/execute ";
-    G4String fileName = argv[1];
-    UImanager -> ApplyCommand( command + fileName );
+    UImanager -> ApplyCommand( command + macro );
   }
   else { 
     // Interactive mode
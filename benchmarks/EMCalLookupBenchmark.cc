@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Main file of the EMCalLookupBenchmark application. It measures the time      //
+//  taken to get the module and role of the logical volume of a step, through    //
+//  the table indexed by the instance ID of the volumes and through the loops    //
+//  over the detector and shower-generator arrays used before it. The            //
+//  calorimeter is built with the numbers of modules in each direction given as  //
+//  arguments ( 1 3 10 30 by default ), and the volumes are drawn at random      //
+//  among the detectors, the shower-generator volumes and the world.             //
+//                                                                               //
+//  Usage: EMCalLookupBenchmark [ modules per side ... ]                         //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalDetectorConstruction.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+//_______________________________________________________________________________
+// Gets the module of < volume > looping over the detector and shower-generator
+// arrays, as the stepping action did before the table was added. Returns the sum
+// of the module and its role, to be compared with that of the table.
+static G4int ScanModule( const EMCalDetectorConstruction *detector,
+			 const G4LogicalVolume           *volume ) {
+
+  size_t size = detector -> GetNmodules();
+
+  for ( size_t imod = 0; imod < size; imod++ )
+    if ( volume == detector -> GetDetector( imod ) )
+      return imod + EMCalDetectorConstruction::kDetector;
+
+  if ( detector -> SGVenabled() )
+    for ( size_t imod = 0; imod < size; imod++ )
+      if ( volume == detector -> GetSGVolume( imod ) )
+	return imod + EMCalDetectorConstruction::kSGVolume;
+
+  return -1 + EMCalDetectorConstruction::kOutside;
+}
+
+//_______________________________________________________________________________
+// Gets the module of < volume > from the table of the detector construction
+static inline G4int TableModule( const EMCalDetectorConstruction *detector,
+				 const G4LogicalVolume           *volume ) {
+
+  const EMCalDetectorConstruction::VolumeInfo &info = detector -> GetVolumeInfo( volume );
+
+  return info.Module + info.Type;
+}
+
+//_______________________________________________________________________________
+// Returns the time in nanoseconds per lookup of < method > over the volumes of
+// < sample >, repeating them until at least a tenth of a second has passed. The
+// sum of the results is saved in < checksum >.
+template<class method>
+static double TimeLookups( method                                     lookup,
+			   const EMCalDetectorConstruction           *detector,
+			   const std::vector<const G4LogicalVolume*> &sample,
+			   long                                      &checksum ) {
+
+  typedef std::chrono::steady_clock clock;
+
+  long   nlookups = 0;
+  double elapsed  = 0;
+  checksum = 0;
+
+  clock::time_point start = clock::now();
+  while ( elapsed < 1e8 ) {
+    for ( size_t i = 0; i < sample.size(); i++ )
+      checksum += lookup( detector, sample[ i ] );
+    nlookups += sample.size();
+    elapsed   = std::chrono::duration<double, std::nano>( clock::now() - start ).count();
+  }
+
+  checksum /= nlookups/sample.size();
+
+  return elapsed/nlookups;
+}
+
+//_______________________________________________________________________________
+
+int main( int argc, char **argv ) {
+
+  std::vector<G4int> sides;
+  for ( int iarg = 1; iarg < argc; iarg++ )
+    sides.push_back( std::atoi( argv[ iarg ] ) );
+  if ( sides.empty() ) {
+    sides.push_back( 1 );
+    sides.push_back( 3 );
+    sides.push_back( 10 );
+    sides.push_back( 30 );
+  }
+
+  EMCalDetectorConstruction *detector = new EMCalDetectorConstruction;
+  detector -> SetSGVolume( true );
+  detector -> SetNzModules( 1 );
+  detector -> SetModuleHalfLengthX( 1*cm );
+  detector -> SetModuleHalfLengthY( 1*cm );
+  detector -> SetModuleHalfLengthZ( 10*cm );
+  detector -> SetDistance( 5*cm );
+
+  std::mt19937 generator( 4357 );
+
+  std::cout << std::setw( 10 ) << "modules"
+	    << std::setw( 16 ) << "scan [ns]"
+	    << std::setw( 16 ) << "table [ns]"
+	    << std::setw( 12 ) << "speed-up" << std::endl;
+
+  for ( size_t iside = 0; iside < sides.size(); iside++ ) {
+
+    G4int side = sides[ iside ];
+
+    detector -> SetNxModules( side );
+    detector -> SetNyModules( side );
+    detector -> SetWorldHalfLengthX( ( 2*side + 10 )*cm );
+    detector -> SetWorldHalfLengthY( ( 2*side + 10 )*cm );
+    detector -> SetWorldHalfLengthZ( 50*cm );
+
+    const G4LogicalVolume *world = detector -> Construct() -> GetLogicalVolume();
+    size_t nmodules = detector -> GetNmodules();
+
+    // The steps are mostly in the modules, half of them in the detectors and half
+    // in the shower-generator volumes, and a tenth in the world
+    std::uniform_int_distribution<size_t> module( 0, nmodules - 1 );
+    std::uniform_real_distribution<double> role( 0, 1 );
+
+    std::vector<const G4LogicalVolume*> sample( 100000 );
+    for ( size_t i = 0; i < sample.size(); i++ ) {
+      double r = role( generator );
+      if ( r < 0.45 )
+	sample[ i ] = detector -> GetDetector( module( generator ) );
+      else if ( r < 0.9 )
+	sample[ i ] = detector -> GetSGVolume( module( generator ) );
+      else
+	sample[ i ] = world;
+    }
+
+    long   scanSum, tableSum;
+    double scan  = TimeLookups( ScanModule, detector, sample, scanSum );
+    double table = TimeLookups( TableModule, detector, sample, tableSum );
+
+    if ( scanSum != tableSum ) {
+      std::cout << "ERROR: The modules given by the table differ from those of the scan"
+		<< std::endl;
+      return 1;
+    }
+
+    std::cout << std::setw( 10 ) << nmodules
+	      << std::setw( 16 ) << scan
+	      << std::setw( 16 ) << table
+	      << std::setw( 12 ) << scan/table << std::endl;
+  }
+
+  delete detector;
+
+  return 0;
+}
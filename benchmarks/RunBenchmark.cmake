@@ -0,0 +1,126 @@
+#########################################
+#                                       #
+#  AUTHOR: Miguel Ramos Pernas          #
+#  e-mail: miguel.ramos.pernas@cern.ch  #
+#                                       # 
+#  Last update: 29/10/2015              #
+#                                       #
+#########################################
+
+#----------------------------------------------------------------------------
+# Runs EMCalorimeter with the macro MACRO for each combination of the output
+# modes in MODES, the pinning layouts in PINNINGS and the numbers of threads in
+# THREADS ( lists separated by commas ), and writes the events and steps per
+# second of each run to the file RESULTS. The speed-up is given with respect to
+# the first number of threads of the same mode and layout. In the macro, @MODE@,
+# @OUTPUT@ and @EVENTS@ are replaced by the output mode, the name of the output
+# file and the number of events EVENTS.
+#
+#   cmake -DEMCAL=<EMCalorimeter> -DMACRO=<macro> -DTHREADS=1,2,4
+#         [ -DMODES=shards,buffer ] [ -DPINNINGS=none,compact ]
+#         [ -DEVENTS=1000 ] [ -DRESULTS=benchmark.csv ] -P RunBenchmark.cmake
+#
+#----------------------------------------------------------------------------
+# Converts the number < value >, printed by G4cout, to an integer number of
+# thousandths, since the arithmetic of cmake only works with integers
+function(to_thousandths value result)
+  string(REGEX MATCH "^([0-9]+)(\\.([0-9]*))?([eE]([+-]?[0-9]+))?$" _match "${value}")
+  set(_digits "${CMAKE_MATCH_1}${CMAKE_MATCH_3}")
+  string(LENGTH "${CMAKE_MATCH_3}" _nfrac)
+  set(_exp "${CMAKE_MATCH_5}")
+  if(NOT _exp)
+    set(_exp 0)
+  endif()
+  math(EXPR _shift "${_exp} - ${_nfrac} + 3")
+  if(_shift GREATER 0)
+    foreach(_i RANGE 1 ${_shift})
+      set(_digits "${_digits}0")
+    endforeach()
+  elseif(_shift LESS 0)
+    string(LENGTH "${_digits}" _n)
+    math(EXPR _n "${_n} + ${_shift}")
+    if(_n GREATER 0)
+      string(SUBSTRING "${_digits}" 0 ${_n} _digits)
+    else()
+      set(_digits 0)
+    endif()
+  endif()
+  math(EXPR _digits "${_digits}")
+  set(${result} ${_digits} PARENT_SCOPE)
+endfunction()
+
+#----------------------------------------------------------------------------
+# Parses the options
+foreach(_list THREADS MODES PINNINGS)
+  string(REPLACE "," ";" ${_list} "${${_list}}")
+endforeach()
+if(NOT MODES)
+  set(MODES shards)
+endif()
+if(NOT PINNINGS)
+  set(PINNINGS none)
+endif()
+if(NOT EVENTS)
+  set(EVENTS 1000)
+endif()
+if(NOT RESULTS)
+  set(RESULTS benchmark.csv)
+endif()
+
+#----------------------------------------------------------------------------
+# Runs each configuration
+file(WRITE ${RESULTS} "mode,pinning,threads,events,events/s,steps/s,speed-up\n")
+message(STATUS "mode\tpinning\tthreads\tevents/s\tsteps/s\tspeed-up")
+
+foreach(MODE ${MODES})
+  foreach(_pinning ${PINNINGS})
+
+    unset(_reference)
+    foreach(_nthreads ${THREADS})
+
+      set(_name   benchmark_${MODE}_${_pinning}_t${_nthreads})
+      set(OUTPUT  ${_name}.root)
+      configure_file(${MACRO} ${_name}.mac @ONLY)
+      file(REMOVE ${OUTPUT})
+
+      execute_process(
+	COMMAND ${CMAKE_COMMAND} -E env EMCAL_PINNING=${_pinning}
+	${EMCAL} -t ${_nthreads} ${_name}.mac
+	RESULT_VARIABLE _result
+	OUTPUT_VARIABLE _log
+	ERROR_VARIABLE  _log
+	)
+      file(WRITE ${_name}.log "${_log}")
+      if(NOT _result EQUAL 0)
+	message(FATAL_ERROR "The run ${_name} failed ( see ${_name}.log )")
+      endif()
+
+      # The rates are those printed by the master at the end of the run
+      string(REGEX MATCH "Events per second:[ \t]*([0-9.eE+-]+)" _match "${_log}")
+      set(_events ${CMAKE_MATCH_1})
+      string(REGEX MATCH "Steps per second:[ \t]*([0-9.eE+-]+)" _match "${_log}")
+      set(_steps ${CMAKE_MATCH_1})
+      if(NOT _events)
+	message(FATAL_ERROR "No rate found in the output of ${_name} ( see ${_name}.log )")
+      endif()
+
+      to_thousandths(${_events} _rate)
+      if(NOT DEFINED _reference)
+	set(_reference ${_rate})
+      endif()
+      math(EXPR _speedup "1000*${_rate}/${_reference}")
+      math(EXPR _units    "${_speedup}/1000")
+      math(EXPR _decimals "${_speedup}%1000 + 1000")
+      string(SUBSTRING ${_decimals} 1 3 _decimals)
+      set(_speedup ${_units}.${_decimals})
+
+      file(APPEND ${RESULTS} "${MODE},${_pinning},${_nthreads},${EVENTS},${_events},${_steps},${_speedup}\n")
+      message(STATUS "${MODE}\t${_pinning}\t${_nthreads}\t${_events}\t${_steps}\t${_speedup}")
+
+      file(REMOVE ${OUTPUT})
+    endforeach()
+
+  endforeach()
+endforeach()
+
+message(STATUS "Results written to ${RESULTS}")
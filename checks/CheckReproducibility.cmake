@@ -0,0 +1,63 @@
+#########################################
+#                                       #
+#  AUTHOR: Miguel Ramos Pernas          #
+#  e-mail: miguel.ramos.pernas@cern.ch  #
+#                                       # 
+#  Last update: 29/10/2015              #
+#                                       #
+#########################################
+
+#----------------------------------------------------------------------------
+# Runs the events of MACRO with each number of threads in THREADS ( separated
+# by commas ) and compares the output trees with that of the first one. The
+# events must be the same, since their seeds only depend on the seed of the
+# run and on their number. The files are named after NAME ( reproducibility by
+# default ), and the values can differ by the relative TOLERANCE ( zero by
+# default ).
+#
+#   cmake -DEMCAL=<EMCalorimeter> -DCOMPARE=<EMCalCompare> -DMACRO=<macro>
+#         -DTHREADS=1,4 [-DNAME=<name>] [-DTOLERANCE=<tolerance>]
+#         -P CheckReproducibility.cmake
+#
+string(REPLACE "," ";" THREADS "${THREADS}")
+if(NOT NAME)
+  set(NAME reproducibility)
+endif()
+if(NOT TOLERANCE)
+  set(TOLERANCE 0)
+endif()
+
+set(outputs)
+foreach(_nthreads ${THREADS})
+
+  set(OUTPUT ${NAME}_t${_nthreads}.root)
+  configure_file(${MACRO} ${NAME}_t${_nthreads}.mac @ONLY)
+  file(REMOVE ${OUTPUT})
+
+  execute_process(
+    COMMAND ${EMCAL} -t ${_nthreads} ${NAME}_t${_nthreads}.mac
+    RESULT_VARIABLE _result
+    OUTPUT_FILE ${NAME}_t${_nthreads}.log
+    ERROR_FILE  ${NAME}_t${_nthreads}.log
+    )
+  if(NOT _result EQUAL 0 OR NOT EXISTS ${OUTPUT})
+    message(FATAL_ERROR "The run with ${_nthreads} threads failed ( see ${NAME}_t${_nthreads}.log )")
+  endif()
+
+  list(APPEND outputs ${OUTPUT})
+endforeach()
+
+#----------------------------------------------------------------------------
+# Compares the trees event by event with those of the first run
+list(GET outputs 0 _reference)
+foreach(_output ${outputs})
+  if(NOT _output STREQUAL _reference)
+    execute_process(
+      COMMAND ${COMPARE} ${_reference} ${_output} tolerance=${TOLERANCE}
+      RESULT_VARIABLE _result
+      )
+    if(NOT _result EQUAL 0)
+      message(FATAL_ERROR "The events of <${_output}> differ from those of <${_reference}>")
+    endif()
+  endif()
+endforeach()
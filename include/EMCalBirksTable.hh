@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the BirksTable class. It gives the visible energy of the steps in a  //
+//  scintillator following Birks' law, dE_vis = dE/( 1 + kB*dE/dx ). The stopping//
+//  powers of electrons, positrons and protons are computed once at the beginning//
+//  of the run and stored as tables of the quenching factor versus the logarithm //
+//  of the kinetic energy, so each step only needs one table lookup. For other   //
+//  charged particles the stopping power is estimated from the step.             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalBirksTable_h
+#define EMCalBirksTable_h 1
+
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "globals.hh"
+
+#include <cmath>
+#include <vector>
+
+class G4Material;
+
+
+//_______________________________________________________________________________
+
+class EMCalBirksTable {
+
+public:
+
+  // Constructor and destructor
+  EMCalBirksTable();
+  ~EMCalBirksTable();
+
+  // Methods
+  void            Build( const G4Material *material, G4double birks );
+  inline G4double GetVisibleEnergy( const G4Step *step ) const;
+
+protected:
+
+  // Method
+  inline G4double Interpolate( const std::vector<G4double> &table, G4double energy ) const;
+
+  // Attributes
+  G4double                    fBirks;
+  const G4ParticleDefinition *fElectron;
+  std::vector<G4double>       fElectronTable;
+  G4double                    fInvDelta;
+  G4double                    fLogEmin;
+  const G4ParticleDefinition *fPositron;
+  std::vector<G4double>       fPositronTable;
+  const G4ParticleDefinition *fProton;
+  std::vector<G4double>       fProtonTable;
+};
+
+// Returns the visible energy of the step. The stopping power is evaluated at the
+// mean kinetic energy of the step.
+inline G4double EMCalBirksTable::GetVisibleEnergy( const G4Step *step ) const {
+
+  G4double edep = step -> GetTotalEnergyDeposit();
+  if ( edep == 0. )
+    return 0.;
+
+  const G4StepPoint          *prePoint = step -> GetPreStepPoint();
+  const G4ParticleDefinition *particle = step -> GetTrack() -> GetDefinition();
+
+  G4double energy = 0.5*( prePoint -> GetKineticEnergy() +
+			  step -> GetPostStepPoint() -> GetKineticEnergy() );
+
+  if ( particle == fElectron )
+    return edep*this -> Interpolate( fElectronTable, energy );
+  else if ( particle == fPositron )
+    return edep*this -> Interpolate( fPositronTable, energy );
+  else if ( particle == fProton )
+    return edep*this -> Interpolate( fProtonTable, energy );
+  else if ( prePoint -> GetCharge() != 0. && step -> GetStepLength() > 0. )
+    return edep/( 1. + fBirks*edep/step -> GetStepLength() );
+  else
+    return edep;
+}
+// Returns the value of the table at the given energy, interpolating linearly in the
+// logarithm of the energy. Outside the range of the table the edge values are used.
+inline G4double EMCalBirksTable::Interpolate( const std::vector<G4double> &table,
+					      G4double                     energy ) const {
+
+  G4double x = ( std::log( energy ) - fLogEmin )*fInvDelta;
+  if ( !( x > 0. ) )
+    return table.front();
+  if ( x >= table.size() - 1 )
+    return table.back();
+
+  size_t ibin = size_t( x );
+  return table[ ibin ] + ( x - ibin )*( table[ ibin + 1 ] - table[ ibin ] );
+}
+
+#endif
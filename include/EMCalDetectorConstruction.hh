@@ -27,8 +27,12 @@
 #include "G4VUserDetectorConstruction.hh"
 #include "G4UnitsTable.hh"
 #include "G4Colour.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ThreeVector.hh"
 #include "globals.hh"
 
+#include <algorithm>
+#include <cfloat>
 #include <vector>
 
 
@@ -46,20 +50,47 @@ public:
   // Destructor
   virtual ~EMCalDetectorConstruction();
 
+  // Role of a logical volume inside the calorimeter
+  enum VolumeType { kOutside = 0, kDetector, kSGVolume };
+
+  // Ways to score the energy deposited in the modules
+  enum ScoringMode { kSteppingAction = 0, kSensitiveDetector };
+
+  // Information attached to each logical volume, so the module owning a volume
+  // can be obtained without looping over the module arrays
+  struct VolumeInfo {
+    VolumeType Type;
+    G4int      Module;
+  };
+
   // Main methods
   virtual G4VPhysicalVolume*       Construct();
+  virtual void                     ConstructSDandField();
+  inline G4double                  GetBirksConstant() const;
   inline const G4LogicalVolume*    GetDetector( G4int idet ) const;
+  inline G4double                  GetDistance() const;
+  inline G4ThreeVector             GetHalfLengths() const;
   inline const G4LogicalVolume*    GetSGVolume( G4int idet ) const;
+  inline G4int                     GetSubCell( const G4ThreeVector &position ) const;
   inline std::vector<EMCalModule*> GetModuleArray() const;
   inline size_t                    GetNmodules() const;
+  inline G4int                     GetNsubCells() const;
+  inline ScoringMode               GetScoringMode() const;
+  inline const VolumeInfo&         GetVolumeInfo( const G4LogicalVolume *volume ) const;
+  inline G4bool                    KillingEscaping() const;
+  inline G4bool                    ReachesEnvelope( const G4ThreeVector &position,
+						    const G4ThreeVector &direction ) const;
   inline G4bool                    SGVenabled() const;
 
   // Messenger methods
   void        DefineMaterials();
   inline void PrintParameters();
+  inline void SetBirksConstant( G4double birks );
   inline void SetDetectorColour( G4String key );
   inline void SetDetectorMaterial( G4String material );
   inline void SetDistance( G4double value );
+  inline void SetEnvelopeMargin( G4double margin );
+  inline void SetKillEscaping( G4bool kill );
   inline void SetModuleHalfLengthX( G4double hlength );
   inline void SetModuleHalfLengthY( G4double hlength );
   inline void SetModuleHalfLengthZ( G4double hlength );
@@ -67,6 +98,10 @@ public:
   inline void SetNxModules( G4int nmodules );
   inline void SetNyModules( G4int nmodules );
   inline void SetNzModules( G4int nmodules );
+  inline void SetNxSubCells( G4int ncells );
+  inline void SetNySubCells( G4int ncells );
+  inline void SetNzSubCells( G4int ncells );
+  void        SetScoringMode( G4String mode );
   inline void SetSGVolume( G4bool dec );
   inline void SetSGVolumeColour( G4String key );
   inline void SetSGVolumeMaterial( G4String material );
@@ -78,40 +113,75 @@ public:
 
 protected:
 
+  // Method
+  void RegisterVolume( const G4LogicalVolume *volume, VolumeType type, G4int imod );
+
   // Main attributes
   EMCalDetectorMessenger        *fMessenger;
   std::vector<EMCalModule*>      fModuleArray;
   std::vector<G4LogicalVolume*>  fSGVolumeArray;
   std::vector<G4LogicalVolume*>  fDetectorArray;
+  VolumeInfo                     fOutsideInfo;
+  G4ThreeVector                  fSubCellScale;
+  G4ThreeVector                  fSubCellShift;
+  std::vector<VolumeInfo>        fVolumeTable;
+
+  // Corners of the envelope around the modules. The tracks out of it which can not
+  // reach it again are killed, if requested.
+  G4ThreeVector                  fEnvelopeMax;
+  G4ThreeVector                  fEnvelopeMin;
 
   // Messenger attributes
-  G4Colour fDetectorColour;
-  G4String fDetectorMaterial;
-  G4double fDistance;
-  G4double fModuleHalfLengthX;
-  G4double fModuleHalfLengthY;
-  G4double fModuleHalfLengthZ;
-  G4double fModuleProportion;
-  G4int    fNxModules;
-  G4int    fNyModules;
-  G4int    fNzModules;
-  G4bool   fSGVolume;
-  G4Colour fSGVolumeColour;
-  G4String fSGVolumeMaterial;
-  G4String fWorldMaterial;
-  G4double fWorldHalfLengthX;
-  G4double fWorldHalfLengthY;
-  G4double fWorldHalfLengthZ;
+  G4double    fBirksConstant;
+  G4Colour    fDetectorColour;
+  G4String    fDetectorMaterial;
+  G4double    fDistance;
+  G4double    fEnvelopeMargin;
+  G4bool      fKillEscaping;
+  G4double    fModuleHalfLengthX;
+  G4double    fModuleHalfLengthY;
+  G4double    fModuleHalfLengthZ;
+  G4double    fModuleProportion;
+  G4int       fNxModules;
+  G4int       fNyModules;
+  G4int       fNzModules;
+  G4int       fNxSubCells;
+  G4int       fNySubCells;
+  G4int       fNzSubCells;
+  ScoringMode fScoringMode;
+  G4bool      fSGVolume;
+  G4Colour    fSGVolumeColour;
+  G4String    fSGVolumeMaterial;
+  G4String    fWorldMaterial;
+  G4double    fWorldHalfLengthX;
+  G4double    fWorldHalfLengthY;
+  G4double    fWorldHalfLengthZ;
 };
 
 //_______________
 // INLINE METHODS
 
+// Returns the Birks constant of the detector material. If zero the energy is not
+// quenched.
+inline G4double
+EMCalDetectorConstruction::GetBirksConstant() const {
+  return fBirksConstant;
+}
 // Returns a constant pointer to the logical detector at position < idet >
 inline const G4LogicalVolume*
 EMCalDetectorConstruction::GetDetector( G4int idet ) const {
   return fDetectorArray.at( idet );
 }
+// Returns the distance from the emission point to the front face of the calorimeter
+inline G4double
+EMCalDetectorConstruction::GetDistance() const {
+  return fDistance;
+}
+// Returns the half lengths of the calorimeter
+inline G4ThreeVector
+EMCalDetectorConstruction::GetHalfLengths() const {
+  return G4ThreeVector( fModuleHalfLengthX, fModuleHalfLengthY, fModuleHalfLengthZ );
+}
 // Returns a constant pointer to the shower-generator volume array at position < isgv >
 inline const G4LogicalVolume*
 EMCalDetectorConstruction::GetSGVolume( G4int isgv ) const {
@@ -127,6 +197,67 @@ inline size_t
 EMCalDetectorConstruction::GetNmodules() const {
   return fModuleArray.size();
 }
+// Returns the number of readout sub-cells in each detector
+inline G4int
+EMCalDetectorConstruction::GetNsubCells() const {
+  return fNxSubCells*fNySubCells*fNzSubCells;
+}
+// Returns the way the energy deposited in the modules is scored
+inline EMCalDetectorConstruction::ScoringMode
+EMCalDetectorConstruction::GetScoringMode() const {
+  return fScoringMode;
+}
+// Returns the index of the readout sub-cell of a detector given the position in its
+// frame. Positions on the faces are assigned to the closest sub-cell.
+inline G4int
+EMCalDetectorConstruction::GetSubCell( const G4ThreeVector &position ) const {
+  G4int
+    ix = G4int( ( position.x() + fSubCellShift.x() )*fSubCellScale.x() ),
+    iy = G4int( ( position.y() + fSubCellShift.y() )*fSubCellScale.y() ),
+    iz = G4int( ( position.z() + fSubCellShift.z() )*fSubCellScale.z() );
+  ix = ix < 0 ? 0 : ( ix < fNxSubCells ? ix : fNxSubCells - 1 );
+  iy = iy < 0 ? 0 : ( iy < fNySubCells ? iy : fNySubCells - 1 );
+  iz = iz < 0 ? 0 : ( iz < fNzSubCells ? iz : fNzSubCells - 1 );
+  return ix + fNxSubCells*( iy + fNySubCells*iz );
+}
+// Returns the role and module index of the given logical volume. The table is
+// indexed by the instance ID of the volume, so the access is done in constant time.
+inline const EMCalDetectorConstruction::VolumeInfo&
+EMCalDetectorConstruction::GetVolumeInfo( const G4LogicalVolume *volume ) const {
+  size_t id = volume -> GetInstanceID();
+  return id < fVolumeTable.size() ? fVolumeTable[ id ] : fOutsideInfo;
+}
+// Tells if the tracks which can not reach the envelope of the modules are killed
+inline G4bool
+EMCalDetectorConstruction::KillingEscaping() const {
+  return fKillEscaping;
+}
+// Tells if a track at < position > moving along < direction > is inside the envelope
+// of the modules or will enter it following a straight line. The points on a face of
+// the envelope which move out of it can not reach it. The points inside are checked
+// first, since most of the steps are done there.
+inline G4bool
+EMCalDetectorConstruction::ReachesEnvelope( const G4ThreeVector &position,
+					    const G4ThreeVector &direction ) const {
+  G4bool inside[ 3 ];
+  for ( G4int i = 0; i < 3; i++ )
+    inside[ i ] = position[ i ] > fEnvelopeMin[ i ] && position[ i ] < fEnvelopeMax[ i ];
+  if ( inside[ 0 ] && inside[ 1 ] && inside[ 2 ] )
+    return true;
+  G4double tmin = 0, tmax = DBL_MAX, t1, t2;
+  for ( G4int i = 0; i < 3; i++ ) {
+    if ( direction[ i ] == 0. ) {
+      if ( inside[ i ] )
+	continue;
+      return false;
+    }
+    t1   = ( fEnvelopeMin[ i ] - position[ i ] )/direction[ i ];
+    t2   = ( fEnvelopeMax[ i ] - position[ i ] )/direction[ i ];
+    tmin = std::max( tmin, std::min( t1, t2 ) );
+    tmax = std::min( tmax, std::max( t1, t2 ) );
+  }
+  return tmax > tmin;
+}
 // Tells if the shower-generator volumes are enabled
 inline G4bool
 EMCalDetectorConstruction::SGVenabled() const {
@@ -148,6 +279,10 @@ inline void EMCalDetectorConstruction::PrintParameters() {
 	 << fNxModules << "\t"
 	 << fNyModules << "\t"
 	 << fNzModules << G4endl;
+  G4cout << " Readout sub-cells ( Nx, Ny, Nz ):\t"
+	 << fNxSubCells << "\t"
+	 << fNySubCells << "\t"
+	 << fNzSubCells << G4endl;
   G4cout << " Size of the modules ( X, Y, Z ): \t"
 	 << fModuleHalfLengthX << "\t"
 	 << fModuleHalfLengthY << "\t"
@@ -155,6 +290,16 @@ inline void EMCalDetectorConstruction::PrintParameters() {
   if ( fSGVolume )
     G4cout << " Detector/module proportion:      \t" << fModuleProportion << G4endl;
   G4cout << " Distance to source:              \t" << fDistance << G4endl;
+  G4cout << " Kill escaping tracks:            \t" << fKillEscaping
+	 << " ( margin " << G4BestUnit( fEnvelopeMargin, "Length" ) << ")" << G4endl;
+  G4cout << " Birks constant ( mm/MeV ):       \t" << fBirksConstant/( mm/MeV ) << G4endl;
+  G4cout << " Scoring mode:                    \t"
+	 << ( fScoringMode == kSensitiveDetector ? "SensitiveDetector" : "SteppingAction" )
+	 << G4endl;
+}
+// Sets the Birks constant of the detector material
+inline void EMCalDetectorConstruction::SetBirksConstant( G4double birks ) {
+  fBirksConstant = birks;
 }
 // Sets the detector colour given its name
 inline void EMCalDetectorConstruction::SetDetectorColour( G4String key ) {
@@ -168,6 +313,15 @@ inline void EMCalDetectorConstruction::SetDetectorMaterial( G4String material )
 inline void EMCalDetectorConstruction::SetDistance( G4double value ) {
   fDistance = value;
 }
+// Sets the distance from the faces of the modules to those of the envelope. The
+// geometry must be updated to apply it.
+inline void EMCalDetectorConstruction::SetEnvelopeMargin( G4double margin ) {
+  fEnvelopeMargin = margin;
+}
+// Sets whether the tracks which can not reach the envelope of the modules are killed
+inline void EMCalDetectorConstruction::SetKillEscaping( G4bool kill ) {
+  fKillEscaping = kill;
+}
 // Sets the half lengths of the modules
 inline void EMCalDetectorConstruction::SetModuleHalfLengthX( G4double hlength ) {
   fModuleHalfLengthX = hlength;
@@ -194,6 +348,17 @@ inline void EMCalDetectorConstruction::SetNyModules( G4int nmodules ) {
 inline void EMCalDetectorConstruction::SetNzModules( G4int nmodules ) {
   fNzModules = nmodules;
 }
+// Sets the number of readout sub-cells of each detector in each space direction.
+// They do not create new volumes, but the geometry must be updated to apply them.
+inline void EMCalDetectorConstruction::SetNxSubCells( G4int ncells ) {
+  fNxSubCells = ncells;
+}
+inline void EMCalDetectorConstruction::SetNySubCells( G4int ncells ) {
+  fNySubCells = ncells;
+}
+inline void EMCalDetectorConstruction::SetNzSubCells( G4int ncells ) {
+  fNzSubCells = ncells;
+}
 // Enables or disables the shower-generator volumes
 inline void EMCalDetectorConstruction::SetSGVolume( G4bool dec ) {
   fSGVolume = dec;
@@ -221,9 +386,11 @@ inline void EMCalDetectorConstruction::SetWorldHalfLengthZ( G4double hlength ) {
 inline void EMCalDetectorConstruction::SetWorldMaterial( G4String material ) {
   fWorldMaterial = material;
 }
-// Updates the geometry of the detector
+// Updates the geometry of the detector. It is built again at the beginning of the
+// next run, when each thread also attaches its own sensitive detector to the new
+// volumes. The command is propagated to the worker threads.
 inline void EMCalDetectorConstruction::UpdateGeometry() {
-  G4RunManager::GetRunManager() -> DefineWorldVolume( this -> Construct() );
+  G4RunManager::GetRunManager() -> ReinitializeGeometry();
 }
 
 #endif
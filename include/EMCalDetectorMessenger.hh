@@ -55,9 +55,12 @@ protected:
   EMCalDetectorConstruction *fDetector;
   G4UIdirectory             *fEMCalDir;
   G4UIdirectory             *fDetDir;
+  G4UIcmdWithADouble        *fBirksConstantCmd;
   G4UIcmdWithAString        *fDetectorColourCmd;
   G4UIcmdWithAString        *fDetectorMaterialCmd;
   G4UIcmdWithADoubleAndUnit *fDistanceCmd;
+  G4UIcmdWithADoubleAndUnit *fEnvelopeMarginCmd;
+  G4UIcmdWithABool          *fKillEscapingCmd;
   G4UIcmdWithADoubleAndUnit *fModuleHalfLengthXcmd;
   G4UIcmdWithADoubleAndUnit *fModuleHalfLengthYcmd;
   G4UIcmdWithADoubleAndUnit *fModuleHalfLengthZcmd;
@@ -65,7 +68,11 @@ protected:
   G4UIcmdWithAnInteger      *fNxModulesCmd;
   G4UIcmdWithAnInteger      *fNyModulesCmd;
   G4UIcmdWithAnInteger      *fNzModulesCmd;
+  G4UIcmdWithAnInteger      *fNxSubCellsCmd;
+  G4UIcmdWithAnInteger      *fNySubCellsCmd;
+  G4UIcmdWithAnInteger      *fNzSubCellsCmd;
   G4UIcmdWithoutParameter   *fPrintCmd;
+  G4UIcmdWithAString        *fScoringModeCmd;
   G4UIcmdWithABool          *fSGVolumeCmd;
   G4UIcmdWithAString        *fSGVolumeColourCmd;
   G4UIcmdWithAString        *fSGVolumeMaterialCmd;
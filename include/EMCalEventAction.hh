@@ -26,10 +26,15 @@
 
 #include "TTree.h"
 
+#include <chrono>
+
 
 //_______________________________________________________________________________
 
+class EMCalDetectorConstruction;
 class EMCalEventActionMessenger;
+class EMCalRun;
+class EMCalSubEventScheduler;
 
 class EMCalEventAction : public G4UserEventAction {
 
@@ -40,20 +45,51 @@ public:
   virtual ~EMCalEventAction();
     
   // Methods
-  virtual void BeginOfEventAction( const G4Event* event );
-  virtual void EndOfEventAction( const G4Event* event );
-  inline  void SetPrintModule( G4int printModule );
+  inline  void      AddSteps( G4int nsteps );
+  virtual void      BeginOfEventAction( const G4Event* event );
+  virtual void      EndOfEventAction( const G4Event* event );
+  inline  EMCalRun* GetRun();
+  inline  void      SetSlowFactor( G4double factor );
+  inline  void      SetSlowTime( G4double time );
 
 protected:
   
+  // Method
+  void TransferHits( const G4Event *event );
+
   // Attributes
-  EMCalEventActionMessenger *fMessenger;
-  G4int                      fPrintModule;
+  const EMCalDetectorConstruction *fDetector;
+  G4int                            fHitsCollectionID;
+  EMCalEventActionMessenger       *fMessenger;
+  EMCalRun                        *fRun;
+  EMCalSubEventScheduler          *fScheduler;
+
+  // Steps of the tracks of the current event, added by the tracking action and given
+  // to the progress meter at the end of the event
+  G4long                           fNsteps;
+
+  // Wall and CPU time at the beginning of the current event, and thresholds on the
+  // time of the events to be saved as slow events: an absolute time and a factor of
+  // the median time of the run. They are not applied if zero.
+  G4double                         fCpuStart;
+  G4double                         fSlowFactor;
+  G4double                         fSlowTime;
+  std::chrono::steady_clock::time_point fWallStart;
 
 };
 
-void inline EMCalEventAction::SetPrintModule( G4int printModule ) {
-  fPrintModule = printModule;
+// Adds the steps of a track to those of the current event
+inline void EMCalEventAction::AddSteps( G4int nsteps ) { fNsteps += nsteps; }
+// Returns the run of this thread, cached at the beginning of each event
+inline EMCalRun* EMCalEventAction::GetRun() { return fRun; }
+// Sets the factor of the median time of the events above which an event is saved
+// as slow. If zero it is not applied.
+void inline EMCalEventAction::SetSlowFactor( G4double factor ) {
+  fSlowFactor = factor;
+}
+// Sets the time above which an event is saved as slow. If zero it is not applied.
+void inline EMCalEventAction::SetSlowTime( G4double time ) {
+  fSlowTime = time;
 }
 
 #endif
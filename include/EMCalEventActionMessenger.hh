@@ -24,7 +24,8 @@
 
 #include "G4UImessenger.hh"
 #include "G4UIdirectory.hh"
-#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
 #include "G4UIcmdWithAString.hh"
 #include "globals.hh"
 
@@ -45,9 +46,10 @@ public:
 protected:
 
   // Attributes
-  EMCalEventAction     *fEventAction;
-  G4UIdirectory        *fEventDir;
-  G4UIcmdWithAnInteger *fPrintModuleCmd;
+  EMCalEventAction          *fEventAction;
+  G4UIdirectory             *fEventDir;
+  G4UIcmdWithADouble        *fSlowFactorCmd;
+  G4UIcmdWithADoubleAndUnit *fSlowTimeCmd;
 
 };
 
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Hit class used by the sensitive detector. Each hit contains the  //
+//  energy deposited in one volume ( detector or shower-generator volume ) of a  //
+//  module during an event.                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalHit_h
+#define EMCalHit_h 1
+
+#include "EMCalDetectorConstruction.hh"
+
+#include "G4VHit.hh"
+#include "G4THitsCollection.hh"
+#include "G4Allocator.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalHit : public G4VHit {
+
+public:
+
+  // Constructor and destructor
+  EMCalHit( G4int module, EMCalDetectorConstruction::VolumeType type );
+  virtual ~EMCalHit();
+
+  // Memory management through the hit allocator
+  inline void* operator new( size_t );
+  inline void  operator delete( void *hit );
+
+  // Methods
+  inline void                                  AddEnergy( G4double edep );
+  inline G4double                              GetEnergy() const;
+  inline G4int                                 GetModule() const;
+  inline G4int                                 GetNsteps() const;
+  inline EMCalDetectorConstruction::VolumeType GetType() const;
+
+protected:
+
+  // Attributes
+  G4double                              fEnergy;
+  G4int                                 fModule;
+  G4int                                 fNsteps;
+  EMCalDetectorConstruction::VolumeType fType;
+};
+
+typedef G4THitsCollection<EMCalHit> EMCalHitsCollection;
+
+extern G4ThreadLocal G4Allocator<EMCalHit> *EMCalHitAllocator;
+
+// Allocates a new hit from the allocator of this thread
+inline void* EMCalHit::operator new( size_t ) {
+  if ( !EMCalHitAllocator )
+    EMCalHitAllocator = new G4Allocator<EMCalHit>;
+  return (void*) EMCalHitAllocator -> MallocSingle();
+}
+// Returns the hit to the allocator of this thread
+inline void EMCalHit::operator delete( void *hit ) {
+  EMCalHitAllocator -> FreeSingle( (EMCalHit*) hit );
+}
+// Adds the energy of one step to the hit
+inline void EMCalHit::AddEnergy( G4double edep ) {
+  fEnergy += edep;
+  fNsteps++;
+}
+// Returns the attributes of the hit
+inline G4double EMCalHit::GetEnergy() const { return fEnergy; }
+inline G4int    EMCalHit::GetModule() const { return fModule; }
+inline G4int    EMCalHit::GetNsteps() const { return fNsteps; }
+inline EMCalDetectorConstruction::VolumeType EMCalHit::GetType() const { return fType; }
+
+#endif
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the MTRunManager class. It is the multithreaded run manager of       //
+//  Geant4, where the number of events given to a worker each time it asks for   //
+//  more is computed from the measured time per event. The chunks take a fixed   //
+//  time, so the workers do not ask the master too often, but never more than a  //
+//  fraction of the remaining events, so they get smaller at the end of the run  //
+//  and the workers finish at the same time. The number of events, of chunks and //
+//  the time of each worker are reported at the end of the run.                  //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#ifndef EMCalMTRunManager_h
+#define EMCalMTRunManager_h 1
+
+#include "EMCalSubEventScheduler.hh"
+
+#include "G4MTRunManager.hh"
+#include "G4Threading.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalMTRunManagerMessenger;
+
+class EMCalMTRunManager : public G4MTRunManager {
+
+public:
+
+  // Constructor and destructor
+  EMCalMTRunManager();
+  virtual ~EMCalMTRunManager();
+
+  // Methods
+  inline EMCalSubEventScheduler* GetSubEventScheduler();
+  virtual void  InitializeEventLoop( G4int n_event, const char *macroFile = 0, G4int n_select = -1 );
+  void          PrintStatistics() const;
+  inline void   SetChunkTime( G4double time );
+  virtual G4int SetUpNEvents( G4Event *evt, G4SeedsQueue *seedsQueue, G4bool reseedRequired = true );
+
+protected:
+
+  typedef std::chrono::steady_clock Clock;
+
+  // Attributes
+  G4double                        fChunkTime;
+  G4double                        fEventTime;
+  EMCalMTRunManagerMessenger     *fMessenger;
+  G4Mutex                         fMutex;
+  EMCalSubEventScheduler         *fScheduler;
+  Clock::time_point               fStart;
+
+  // Statistics of each worker. The last chunk is used to measure the time per event
+  // when the worker asks for the next one.
+  std::vector<G4int>              fWorkerChunks;
+  std::vector<G4int>              fWorkerEvents;
+  std::vector<Clock::time_point>  fWorkerEnd;
+  std::vector<G4int>              fWorkerLastChunk;
+  std::vector<Clock::time_point>  fWorkerLastRequest;
+};
+
+// Returns the scheduler of the sub-events processed by the workers
+inline EMCalSubEventScheduler* EMCalMTRunManager::GetSubEventScheduler() { return fScheduler; }
+// Sets the time the chunks of events given to the workers should take. If zero, the
+// chunks have the fixed size set by the event modulo.
+inline void EMCalMTRunManager::SetChunkTime( G4double time ) {
+  fChunkTime = time;
+  G4cout << " Time of the chunks of events set to <" << time/CLHEP::s << " s>" << G4endl;
+}
+
+#endif
+
+#endif
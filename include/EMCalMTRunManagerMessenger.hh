@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the MTRunManager class, to set the time of the      //
+//  chunks of events given to the workers.                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#ifndef EMCalMTRunManagerMessenger_h
+#define EMCalMTRunManagerMessenger_h 1
+
+#include "EMCalMTRunManager.hh"
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalMTRunManagerMessenger: public G4UImessenger {
+
+public:
+
+  // Constructor and destructor
+  EMCalMTRunManagerMessenger( EMCalMTRunManager *runManager );
+  ~EMCalMTRunManagerMessenger();
+
+  // Method
+  void SetNewValue( G4UIcommand *command, G4String value );
+
+protected:
+
+  // Attributes
+  EMCalMTRunManager         *fRunManager;
+  G4UIdirectory             *fDispatchDir;
+  G4UIcmdWithADoubleAndUnit *fChunkTimeCmd;
+  G4UIcmdWithADoubleAndUnit *fSubEventEnergyCmd;
+  G4UIcmdWithADoubleAndUnit *fSubEventMinEnergyCmd;
+
+};
+
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the OutputWriter class. It fills the output tree in a separate       //
+//  thread, so the compression and the writing of the baskets do not stop the    //
+//  simulation. The variables of each branch are bound to a copy owned by the    //
+//  writer. At the end of each event the variables are copied into a record of a //
+//  bounded queue with a single producer and a single consumer, without locks,   //
+//  and the writer thread copies them back and fills the tree. If the queue is   //
+//  full the simulation waits for the writer.                                    //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalOutputWriter_h
+#define EMCalOutputWriter_h 1
+
+#include "globals.hh"
+
+#include "TTree.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalOutputWriter {
+
+public:
+
+  // Constructor and destructor
+  EMCalOutputWriter( size_t capacity );
+  ~EMCalOutputWriter();
+
+  // Methods
+  void* Bind( void *source, size_t size, size_t n = 1, const G4int *count = 0 );
+  void  PrintStatistics() const;
+  void  Push();
+  void  Start( TTree *tree, G4int flushEntries, G4bool flushFile );
+  void  Stop();
+
+protected:
+
+  // Nested struct holding a variable bound to a branch. If the variable is an array
+  // with a variable number of elements, the counter of the source and that of the
+  // copy are kept, so only the used elements are copied.
+  struct Block {
+
+    const char  *Source;
+    char        *Copy;
+    size_t       Size;
+    size_t       Offset;
+    const G4int *SourceCount;
+    const G4int *CopyCount;
+  };
+
+  // Method executed by the writer thread
+  void Run();
+
+  // Attributes
+  std::vector<Block>  fBlocks;
+  size_t              fCapacity;
+  G4int               fFlushEntries;
+  G4bool              fFlushFile;
+  size_t              fRecordSize;
+  char               *fRecords;
+  std::thread         fThread;
+  TTree              *fTree;
+
+  // Positions of the next record to write and to read. They only increase, so the
+  // number of records in the queue is their difference.
+  std::atomic<size_t> fHead;
+  std::atomic<size_t> fTail;
+  std::atomic<bool>   fStop;
+
+  // Statistics of the queue, only modified by the producer
+  size_t              fNrecords;
+  size_t              fNfull;
+  size_t              fMaxDepth;
+  G4double            fSumDepth;
+  G4double            fWaitTime;
+};
+
+#endif
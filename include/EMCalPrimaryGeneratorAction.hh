@@ -42,7 +42,12 @@ public:
 
   // Methods
   virtual void         GeneratePrimaries( G4Event *event );         
+  static void          GetEventSeeds( G4long runSeed,
+				      G4int  evtNb,
+				      long  *seeds,
+				      G4int  subEvent = -1 );
   const G4ParticleGun* GetParticleGun() const { return fParticleGun; }
+  static void          SeedEvent( G4long runSeed, G4int evtNb, G4int subEvent = -1 );
   void                 SetEnergyShape( G4String shape );
   inline void          SetMaxPhi( G4double value );
   inline void          SetMaxTheta( G4double value );
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Profile class. It is a histogram with fixed bins, used to        //
+//  accumulate the energy deposited in the calorimeter versus the depth and the  //
+//  distance to the axis of the primary particle during the run. Each thread     //
+//  fills its own profiles, which are added at the end of the run and converted  //
+//  to ROOT histograms.                                                          //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalProfile_h
+#define EMCalProfile_h 1
+
+#include "globals.hh"
+
+#include "TH1D.h"
+
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalProfile {
+
+public:
+
+  // Constructor and destructor
+  EMCalProfile();
+  ~EMCalProfile();
+
+  // Methods
+  void         Add( const EMCalProfile &other );
+  void         Configure( G4int nbins, G4double min, G4double max );
+  inline void  Fill( G4double x, G4double weight );
+  inline G4int GetNbins() const;
+  TH1D*        MakeHistogram( const char *name, const char *title ) const;
+
+protected:
+
+  // Attributes. The first and last positions of the vectors are the underflow and
+  // overflow bins.
+  G4double              fInvWidth;
+  G4double              fMax;
+  G4double              fMin;
+  G4int                 fNbins;
+  std::vector<G4double> fSumW;
+  std::vector<G4double> fSumW2;
+};
+
+// Adds < weight > to the bin corresponding to < x >
+inline void EMCalProfile::Fill( G4double x, G4double weight ) {
+
+  G4int bin;
+  if ( x < fMin )
+    bin = 0;
+  else if ( x >= fMax )
+    bin = fNbins + 1;
+  else {
+    bin = 1 + G4int( ( x - fMin )*fInvWidth );
+    if ( bin > fNbins )
+      bin = fNbins;
+  }
+
+  fSumW[ bin ]  += weight;
+  fSumW2[ bin ] += weight*weight;
+}
+// Returns the number of bins
+inline G4int EMCalProfile::GetNbins() const { return fNbins; }
+
+#endif
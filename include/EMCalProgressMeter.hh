@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the ProgressMeter class. It reports the progress of the run, the     //
+//  number of events and steps processed per second and the estimated time to    //
+//  finish it, as well as the rates of each thread. The threads add their events //
+//  and steps to their own counters, and the first thread finding that the       //
+//  interval since the last report has passed prints the next one, so a single   //
+//  report is printed for the whole run.                                         //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalProgressMeter_h
+#define EMCalProgressMeter_h 1
+
+#include "G4UnitsTable.hh"
+#include "globals.hh"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+
+//_______________________________________________________________________________
+
+class EMCalProgressMeter {
+
+public:
+
+  // Constructor and destructor
+  EMCalProgressMeter();
+  ~EMCalProgressMeter();
+
+  // Methods
+  void                       AddEvent( G4int nevents, G4long nsteps );
+  static EMCalProgressMeter* GetInstance();
+  void                       PrintStatistics() const;
+  inline void                SetInterval( G4double interval );
+  void                       StartRun( G4int nevents, G4int nthreads );
+
+protected:
+
+  // Events and steps processed by a thread. They are placed in different cache lines
+  // so the threads do not invalidate those of the others when they are updated. The
+  // alignment also pads the size of the structure to a whole cache line.
+  struct alignas( 64 ) Counter {
+    std::atomic<G4long> Events;
+    std::atomic<G4long> Steps;
+  };
+
+  // Methods
+  G4double Elapsed() const;
+  void     Report( G4double elapsed );
+
+  // Attributes
+  Counter                               *fCounters;
+  G4double                               fInterval;
+  std::mutex                             fMutex;
+  G4int                                  fNevents;
+  G4int                                  fNthreads;
+  std::chrono::steady_clock::time_point  fStartTime;
+
+  // Elapsed time, in nanoseconds, when the next report is printed, and time and
+  // events of each thread at the previous one, to compute their current rates
+  std::atomic<G4long>                    fNextReport;
+  G4double                               fLastReport;
+  G4long                                *fLastEvents;
+
+  // Meter of the run manager, shared by all the threads
+  static EMCalProgressMeter             *fInstance;
+};
+
+// Sets the interval between two reports. If zero no report is printed during the run.
+inline void EMCalProgressMeter::SetInterval( G4double interval ) {
+  fInterval = interval;
+  G4cout << " Interval between progress reports set to <"
+	 << G4BestUnit( interval, "Time" ) << ">" << G4endl;
+}
+
+#endif
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Quantile class, which estimates a quantile of a sequence of      //
+//  values without storing them, following the P-square algorithm of Jain and    //
+//  Chlamtac. Five markers are kept, whose heights approach the minimum, the     //
+//  maximum, the quantile and the middle points between them as the values are   //
+//  added.                                                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalQuantile_h
+#define EMCalQuantile_h 1
+
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalQuantile {
+
+public:
+
+  // Constructor and destructor
+  EMCalQuantile( G4double probability = 0.5 );
+  ~EMCalQuantile();
+
+  // Methods
+  void           Add( const EMCalQuantile &other );
+  void           Fill( G4double x );
+  inline G4int   GetEntries() const;
+  G4double       GetValue() const;
+  void           Reset();
+
+  // Number of markers
+  static const G4int kMarkers = 5;
+
+protected:
+
+  // Attributes. The positions of the markers start at zero.
+  G4int    fCount;
+  G4double fDesired[ kMarkers ];
+  G4double fHeights[ kMarkers ];
+  G4double fIncrements[ kMarkers ];
+  G4double fPositions[ kMarkers ];
+  G4double fProbability;
+};
+
+// Returns the number of values added
+inline G4int EMCalQuantile::GetEntries() const { return fCount; }
+
+#endif
@@ -21,7 +21,13 @@
 #ifndef EMCalRun_h
 #define EMCalRun_h 1
 
+#include "EMCalBirksTable.hh"
 #include "EMCalDetectorConstruction.hh"
+#include "EMCalOutputWriter.hh"
+#include "EMCalProfile.hh"
+#include "EMCalQuantile.hh"
+#include "EMCalStepHit.hh"
+#include "EMCalSubEvent.hh"
 
 #include "G4RunManager.hh"
 #include "G4Run.hh"
@@ -29,6 +35,12 @@
 
 #include "TTree.h"
 
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+class G4Step;
+
 
 //_______________________________________________________________________________
 
@@ -53,33 +65,140 @@ public:
     G4int    nSgvInteractions;
   };
 
+  // Nested struct with the information of an event which took more time than the
+  // threshold, to be simulated again
+  struct SlowEvent {
+
+    G4int         Number;
+    G4double      WallTime;
+    G4double      CpuTime;
+    G4double      Energy;
+    G4ThreeVector Direction;
+  };
+
   // Methods
   inline void               AddEnergyToDetector( G4double edep,
-						 G4int    idet );
+						 G4int    idet,
+						 G4int    nsteps = 1 );
   inline void               AddEnergyToSGVolume( G4double edep,
-						 G4int    idet );
+						 G4int    idet,
+						 G4int    nsteps = 1 );
+  inline void               AddEscapedEnergy( G4double energy );
+  void                      AddEventTime( G4double wall, G4double cpu );
+  inline void               AddSlowEvent( const SlowEvent &event );
+  void                      AddEnergyToSubCell( const G4Step *step, G4int idet );
+  inline void               AddPulse( G4double edep, G4double time, G4int idet );
+  inline void               AddQuenchedEnergy( const G4Step *step );
+  void                      EnablePulses( G4double width, G4double start, G4double length );
+  void                      EnableProfiles( G4int nbins );
+  void                      EnableQuenching( const G4Material *material, G4double birks );
+  inline void               EnableSelection( G4double leakage, G4int modules );
+  void                      EnableStepRecording( TTree *tree );
+  void                      ExportSubEvent( EMCalSubEvent *subEvent ) const;
   void                      Fill( const G4int &evtNb );
+  void                      FillProfiles( const G4Step *step );
+  inline G4bool             FillingProfiles() const;
+  inline G4double           GetMedianEventTime() const;
   inline size_t             GetNbranches() const;
   inline PhysicalVariables* GetPathTo( size_t index );
+  inline const std::vector<G4int>& GetSelectedEvents() const;
+  inline const std::vector<SlowEvent>& GetSlowEvents() const;
+  virtual void              Merge( const G4Run *run );
+  void                      MergeSubEvent( const EMCalSubEvent *subEvent );
+  void                      RecordStep( const G4Step                         *step,
+					G4int                                 module,
+					EMCalDetectorConstruction::VolumeType type );
+  void                      PrintStatistics() const;
+  virtual void              RecordEvent( const G4Event *event );
+  inline G4bool             RecordingSteps() const;
   void                      Reset();
+  inline void               ScoreStepOptions( const G4Step                         *step,
+					      G4int                                 module,
+					      EMCalDetectorConstruction::VolumeType type );
+  void                      SelectKernels( G4bool sgv, G4bool grid );
+  inline void               SetFlushEntries( G4int entries, G4bool writeFile );
+  inline G4bool             PulsesEnabled() const;
+  inline G4bool             QuenchingEnabled() const;
+  inline G4bool             SegmentationEnabled() const;
+  inline G4bool             StepOptionsEnabled() const;
   inline void               SetOutputTree( TTree *tree );
+  inline void               SetOutputWriter( EMCalOutputWriter *writer );
+  inline void               SetPrimaryAxis( const G4ThreeVector &origin,
+					    const G4ThreeVector &direction );
+  inline void               Touch( size_t idet );
+  inline void               UpdateStackPeak( size_t nstacked, size_t noverflow );
   inline G4double*          DetectorEnergyPath();
+  inline G4int*             EventNumberPath();
+  inline G4double*          EscapedEnergyPath();
   inline G4double*          LostEnergyPath();
+  inline G4int*             nCellsPath();
+  inline G4int*             CellModulePath();
+  inline G4int*             CellIndexPath();
+  inline G4double*          CellEnergyPath();
   inline G4int*             nDetHitsPath();
   inline G4int*             nSgvHitsPath();
+  inline G4double*          QuenchedEnergyPath();
+  inline G4double*          GateEnergyPath();
+  inline G4double*          OutOfGateEnergyPath();
+  inline G4int*             nPulsesPath();
+  inline G4int*             PulseModulePath();
+  inline G4double*          PulseGateEnergyPath();
   inline G4double*          TrueEnergyPath();
   inline G4double*          SGVolumeEnergyPath();
   inline const char*        Title();
+  void                      WriteProfiles() const;
+
+  // Number of time bins of the pulse of each module
+  static const size_t kTimeBins = 64;
 
 private:
 
+  // Kernel to get the energy deposited in the modules
+  template<G4bool sgv, G4bool grid> void Aggregate();
+  typedef void ( EMCalRun::*AggregateKernel )();
+
+  // Options applied to each step with energy deposited in a scoring volume
+  void AddPulseOption( const G4Step                         *step,
+		       G4int                                 module,
+		       EMCalDetectorConstruction::VolumeType type );
+  void AddQuenchedEnergyOption( const G4Step                         *step,
+				G4int                                 module,
+				EMCalDetectorConstruction::VolumeType type );
+  void AddEnergyToSubCellOption( const G4Step                         *step,
+				 G4int                                 module,
+				 EMCalDetectorConstruction::VolumeType type );
+  void FillProfilesOption( const G4Step                         *step,
+			   G4int                                 module,
+			   EMCalDetectorConstruction::VolumeType type );
+  typedef void ( EMCalRun::*StepOption )( const G4Step*,
+					  G4int,
+					  EMCalDetectorConstruction::VolumeType );
+
+  // Methods to write the step hits
+  void FillStepTree( const G4int &evtNb );
+  void SetStepBranchAddresses();
+
+  // Detector construction, shared by all the threads
+  const EMCalDetectorConstruction *fDetector;
+
   // Attributes
   size_t             fNbranches;
   TTree             *fOutputTree;
   const char        *fTitle;
 
+  // Number of entries after which the output tree is saved, and whether the file
+  // is written instead, sending the entries to the merger of the output file
+  G4int              fFlushEntries;
+  G4bool             fFlushFile;
+
+  // Thread filling the output tree. If it is set, the variables of each event are
+  // sent to it instead of filling the tree.
+  EMCalOutputWriter *fWriter;
+
   // Attributes that are variables of the complete calorimeter
   G4double           fDetectorEnergy;
+  G4int              fEventNumber;
+  G4double           fEscapedEnergy;
   G4double           fLostEnergy;
   G4int              fNdetHits;
   G4int              fNsgvHits;
@@ -87,19 +206,147 @@ private:
   G4double           fTrueEnergy;
   PhysicalVariables *fVariablesVector;
 
+  // Sums over the events of the run, added from all the threads when merging
+  G4double           fSumDetectorEnergy;
+  G4double           fSumDetectorEnergy2;
+  G4double           fSumEscapedEnergy;
+  G4double           fSumLostEnergy;
+
+  // Events selected to be simulated again with more detail. An event is selected if
+  // the fraction of the energy lost is above < fSelectLeakage >, or the number of
+  // detectors with energy deposited reaches < fSelectModules >. The criteria are
+  // disabled if set to zero.
+  G4bool             fSelecting;
+  G4double           fSelectLeakage;
+  G4int              fSelectModules;
+  std::vector<G4int> fSelectedEvents;
+
+  // Maximum number of tracks in the stack of the thread and saved out of it by the
+  // stacking action, and time when the run started, to report the memory and the
+  // throughput of the run
+  size_t             fPeakOverflow;
+  size_t             fPeakStacked;
+  std::chrono::steady_clock::time_point fStartTime;
+
+  // Wall and CPU time taken by the events, in seconds. The median and the tail of the
+  // wall time are estimated without storing the times. The events taking more time
+  // than the threshold are saved.
+  G4int                  fNtimedEvents;
+  G4double               fSumCpuTime;
+  G4double               fSumWallTime;
+  EMCalQuantile          fWallTimeMedian;
+  EMCalQuantile          fWallTimeTail;
+  std::vector<SlowEvent> fSlowEvents;
+
+  // Modules with energy deposited in the current event. Only these modules are
+  // visited when the event is filled and reset.
+  size_t             fNtouched;
+  size_t            *fTouchedModules;
+  G4bool            *fTouchedFlags;
+
+  // Kernel selected for the geometry of the current run, and options enabled in it
+  // for the steps, so they are not checked in each step
+  AggregateKernel    fAggregate;
+  size_t             fNstepOptions;
+  StepOption         fStepOptions[ 5 ];
+
+  // Energy deposited in the detectors in bins of time. Each module has < kTimeBins >
+  // bins, followed by one for the energy after the last bin. The energy integrated
+  // in the gate and out of it is written for the complete calorimeter and for each
+  // module with energy deposited.
+  G4bool                   fPulses;
+  G4double                 fInvTimeBinWidth;
+  size_t                   fGateFirstBin;
+  size_t                   fGateLastBin;
+  G4double                *fModPulse;
+  G4double                 fGateEnergy;
+  G4double                 fOutOfGateEnergy;
+  G4int                    fNpulses;
+  std::vector<G4int>       fPulseModule;
+  std::vector<G4double>    fPulseGateEnergy;
+
+  // Visible energy in the detectors, after applying Birks' law to each step
+  EMCalBirksTable          fBirksTable;
+  G4bool                   fQuench;
+  G4double                 fQuenchedEnergy;
+
+  // Energy deposited in the readout sub-cells of the detectors, with the list of
+  // sub-cells with energy deposited in the current event. These are written as
+  // arrays of the module, the sub-cell and the energy.
+  G4int                    fNsubCells;
+  std::vector<G4double>    fSubCellEnergy;
+  std::vector<G4int>       fTouchedSubCells;
+  G4int                    fNcells;
+  std::vector<G4int>       fCellModule;
+  std::vector<G4int>       fCellIndex;
+  std::vector<G4double>    fCellEnergy;
+
+  // Profiles of the energy deposited versus the depth and the distance to the axis
+  // of the primary particle of the current event
+  G4bool                   fFillProfiles;
+  G4double                 fFrontFace;
+  EMCalProfile             fLateralProfile;
+  EMCalProfile             fLongitudinalProfile;
+  G4ThreeVector            fPrimaryDirection;
+  G4ThreeVector            fPrimaryOrigin;
+
+  // Step hits of the current event and buffers of the tree where they are written.
+  // The tree is only set if the steps are recorded.
+  EMCalStepHitsCollection *fStepHits;
+  TTree                   *fStepTree;
+  Int_t                    fStepEvent;
+  Int_t                    fNstepHits;
+  size_t                   fStepCapacity;
+  std::vector<Int_t>       fStepModule;
+  std::vector<Char_t>      fStepType;
+  std::vector<Float_t>     fStepX;
+  std::vector<Float_t>     fStepY;
+  std::vector<Float_t>     fStepZ;
+  std::vector<Float_t>     fStepTime;
+  std::vector<Float_t>     fStepEnergy;
+  std::vector<Int_t>       fStepPDG;
+
 };
 
-// Adds energy to the detector at position < idet >
+// Adds energy to the time bin of the detector at position < idet >. The energy
+// deposited after the last bin is added to the overflow bin of the module.
+inline void EMCalRun::AddPulse( G4double edep, G4double time, G4int idet ) {
+  this -> Touch( idet );
+  G4double x   = time*fInvTimeBinWidth;
+  size_t   bin = x < kTimeBins ? ( x > 0. ? size_t( x ) : 0 ) : kTimeBins;
+  fModPulse[ idet*( kTimeBins + 1 ) + bin ] += edep;
+}
+// Adds the visible energy of a step in a detector, looked up in the Birks tables
+inline void EMCalRun::AddQuenchedEnergy( const G4Step *step ) {
+  fQuenchedEnergy += fBirksTable.GetVisibleEnergy( step );
+}
+// Adds energy to the detector at position < idet >, coming from < nsteps > steps
 inline void EMCalRun::AddEnergyToDetector( G4double edep,
-					   G4int    idet ) {
+					   G4int    idet,
+					   G4int    nsteps ) {
+  this -> Touch( idet );
   fVariablesVector[ idet ].DetectorEnergy += edep;
-  fVariablesVector[ idet ].nDetInteractions++;
+  fVariablesVector[ idet ].nDetInteractions += nsteps;
 }
-// Adds energy to the shower-generator volume at position < idet >
+// Adds energy to the shower-generator volume at position < idet >, coming from
+// < nsteps > steps
 inline void EMCalRun::AddEnergyToSGVolume( G4double edep,
-					   G4int    idet ) {
+					   G4int    idet,
+					   G4int    nsteps ) {
+  this -> Touch( idet );
   fVariablesVector[ idet ].SGVolumeEnergy += edep;
-  fVariablesVector[ idet ].nSgvInteractions++;
+  fVariablesVector[ idet ].nSgvInteractions += nsteps;
+}
+// Adds the kinetic energy of a track killed out of the envelope of the modules. It is
+// part of the energy lost by the calorimeter.
+inline void EMCalRun::AddEscapedEnergy( G4double energy ) { fEscapedEnergy += energy; }
+// Saves an event which took more time than the threshold
+inline void EMCalRun::AddSlowEvent( const SlowEvent &event ) { fSlowEvents.push_back( event ); }
+// Enables the selection of events to be simulated again
+inline void EMCalRun::EnableSelection( G4double leakage, G4int modules ) {
+  fSelecting     = leakage > 0 || modules > 0;
+  fSelectLeakage = leakage;
+  fSelectModules = modules;
 }
 // Gets the number of branches in the tree
 inline size_t EMCalRun::GetNbranches() const { return fNbranches; }
@@ -107,15 +354,83 @@ inline size_t EMCalRun::GetNbranches() const { return fNbranches; }
 inline EMCalRun::PhysicalVariables* EMCalRun::GetPathTo( size_t index ) {
   return fVariablesVector + index;
 }
+// Returns the estimate of the median of the wall time of the events, in seconds
+inline G4double EMCalRun::GetMedianEventTime() const { return fWallTimeMedian.GetValue(); }
+// Returns the numbers of the events selected in the run
+inline const std::vector<G4int>& EMCalRun::GetSelectedEvents() const { return fSelectedEvents; }
+// Returns the events of the run which took more time than the threshold
+inline const std::vector<EMCalRun::SlowEvent>& EMCalRun::GetSlowEvents() const {
+  return fSlowEvents;
+}
+// Returns whether the shower profiles are being filled
+inline G4bool      EMCalRun::FillingProfiles() const { return fFillProfiles; }
+// Returns whether the steps depositing energy are being recorded
+inline G4bool      EMCalRun::RecordingSteps() const { return fStepTree != 0; }
+// Returns whether the energy in the detectors is binned in time
+inline G4bool      EMCalRun::PulsesEnabled() const { return fPulses; }
+// Returns whether the visible energy in the detectors is computed
+inline G4bool      EMCalRun::QuenchingEnabled() const { return fQuench; }
+// Returns whether the detectors are divided in readout sub-cells
+inline G4bool      EMCalRun::SegmentationEnabled() const { return fNsubCells > 1; }
+// Applies the options enabled in the run to a step in the volume of type < type > of
+// the module < module >
+inline void EMCalRun::ScoreStepOptions( const G4Step                         *step,
+					G4int                                 module,
+					EMCalDetectorConstruction::VolumeType type ) {
+  for ( size_t iopt = 0; iopt < fNstepOptions; iopt++ )
+    ( this ->* fStepOptions[ iopt ] )( step, module, type );
+}
+// Returns whether any option is applied to the steps in the scoring volumes
+inline G4bool      EMCalRun::StepOptionsEnabled() const { return fNstepOptions > 0; }
+// Sets the number of entries after which the output is saved, and whether the
+// complete file is written
+inline void        EMCalRun::SetFlushEntries( G4int entries, G4bool writeFile ) {
+  fFlushEntries = entries;
+  fFlushFile    = writeFile;
+}
 // Sets the output tree pointer
 inline void        EMCalRun::SetOutputTree( TTree *tree ) { fOutputTree = tree; }
+// Sets the thread filling the output tree
+inline void        EMCalRun::SetOutputWriter( EMCalOutputWriter *writer ) {
+  fWriter = writer;
+}
+// Sets the axis of the primary particle of the current event, used by the profiles
+inline void        EMCalRun::SetPrimaryAxis( const G4ThreeVector &origin,
+					     const G4ThreeVector &direction ) {
+  fPrimaryOrigin    = origin;
+  fPrimaryDirection = direction;
+}
+// Marks the module at position < idet > as touched in the current event
+inline void EMCalRun::Touch( size_t idet ) {
+  if ( !fTouchedFlags[ idet ] ) {
+    fTouchedFlags[ idet ] = true;
+    fTouchedModules[ fNtouched++ ] = idet;
+  }
+}
+// Updates the maximum number of tracks in the stack and saved out of it
+inline void EMCalRun::UpdateStackPeak( size_t nstacked, size_t noverflow ) {
+  fPeakStacked  = std::max( fPeakStacked, nstacked );
+  fPeakOverflow = std::max( fPeakOverflow, noverflow );
+}
 // Sets the title of the calorimeter variables
 inline const char* EMCalRun::Title()                      { return fTitle; }
 // Returns the path for the different attributes
 inline G4double*   EMCalRun::DetectorEnergyPath()         { return &fDetectorEnergy; }
+inline G4int*      EMCalRun::EventNumberPath()            { return &fEventNumber; }
+inline G4double*   EMCalRun::EscapedEnergyPath()          { return &fEscapedEnergy; }
 inline G4double*   EMCalRun::LostEnergyPath()             { return &fLostEnergy; }
+inline G4int*      EMCalRun::nCellsPath()                 { return &fNcells; }
+inline G4int*      EMCalRun::CellModulePath()             { return &fCellModule[ 0 ]; }
+inline G4int*      EMCalRun::CellIndexPath()              { return &fCellIndex[ 0 ]; }
+inline G4double*   EMCalRun::CellEnergyPath()             { return &fCellEnergy[ 0 ]; }
 inline G4int*      EMCalRun::nDetHitsPath()               { return &fNdetHits; }
 inline G4int*      EMCalRun::nSgvHitsPath()               { return &fNsgvHits; }
+inline G4double*   EMCalRun::QuenchedEnergyPath()         { return &fQuenchedEnergy; }
+inline G4double*   EMCalRun::GateEnergyPath()             { return &fGateEnergy; }
+inline G4double*   EMCalRun::OutOfGateEnergyPath()        { return &fOutOfGateEnergy; }
+inline G4int*      EMCalRun::nPulsesPath()                { return &fNpulses; }
+inline G4int*      EMCalRun::PulseModulePath()            { return &fPulseModule[ 0 ]; }
+inline G4double*   EMCalRun::PulseGateEnergyPath()        { return &fPulseGateEnergy[ 0 ]; }
 inline G4double*   EMCalRun::SGVolumeEnergyPath()         { return &fSGVolumeEnergy; }
 inline G4double*   EMCalRun::TrueEnergyPath()             { return &fTrueEnergy; }
 
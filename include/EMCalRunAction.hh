@@ -22,55 +22,193 @@
 #ifndef EMCalRunAction_h
 #define EMCalRunAction_h 1
 
+#include "EMCalOutputWriter.hh"
+#include "EMCalProgressMeter.hh"
 #include "EMCalRun.hh"
 
+#include "G4RunManager.hh"
 #include "G4UserRunAction.hh"
+#include "G4UnitsTable.hh"
 #include "globals.hh"
 
+#include "RVersion.h"
 #include "TFile.h"
 #include "TTree.h"
 
+#include <vector>
+
+// The buffer merger is available since Root 6.10, and out of the experimental
+// namespace since Root 6.26
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 10, 0 )
+#define EMCAL_BUFFER_MERGER 1
+#include "ROOT/TBufferMerger.hxx"
+#include <memory>
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 26, 0 )
+typedef ROOT::TBufferMerger                   EMCalBufferMerger;
+typedef ROOT::TBufferMergerFile               EMCalBufferMergerFile;
+#else
+typedef ROOT::Experimental::TBufferMerger     EMCalBufferMerger;
+typedef ROOT::Experimental::TBufferMergerFile EMCalBufferMergerFile;
+#endif
+#endif
+
 
 //_______________________________________________________________________________
 
 class EMCalRunActionMessenger;
+class EMCalSteppingAction;
 
 class EMCalRunAction : public G4UserRunAction {
 
 public:
 
   // Constructor and destructor
-  EMCalRunAction();
+  EMCalRunAction( EMCalSteppingAction *steppingAction = 0 );
   virtual ~EMCalRunAction();
 
   // Methods
-  inline  void   CreateNewFile( G4String name );
   virtual void   BeginOfRunAction( const G4Run* );
   virtual void   EndOfRunAction( const G4Run* );
+  void           ForkBeamOn( G4int nevents );
   virtual G4Run* GenerateRun();
+  void           Replay( G4String name );
+  static G4int   GetEventNumber( G4int eventID );
+  static G4int   GetFirstEvent();
+  static G4long  GetRunSeed();
   inline  TTree* GetOutputTree();
+  void           Resume();
+  inline  void   SetCheckpoint( G4bool checkpoint );
+  inline  void   SetFlushEntries( G4int entries );
+  inline  void   SetFirstEvent( G4int first );
+  inline  void   SetGateLength( G4double length );
+  inline  void   SetGateStart( G4double start );
+  void           SetOutputFileName( G4String name );
+  void           SetOutputMode( G4String mode );
   inline  void   SetOutputTreeName( G4String name );
+  inline  void   SetProcesses( G4int nprocesses );
+  inline  void   SetProfileBins( G4int nbins );
+  void           SetProgressInterval( G4double interval );
+  inline  void   SetRecordSteps( G4bool record );
+  inline  void   SetSeed( G4long seed );
+  inline  void   SetSelectLeakage( G4double fraction );
+  inline  void   SetSelectModules( G4int nmodules );
+  inline  void   SetSelectionFile( G4String name );
+  inline  void   SetSlowEventFile( G4String name );
+  inline  void   SetTimeBinWidth( G4double width );
+  inline  void   SetWriterQueue( G4int capacity );
 
 protected:
+
+  // Methods
+  template<class type>
+  TBranch* AddBranch( const char  *name,
+		      type        *address,
+		      const char  *leaves,
+		      size_t       n     = 1,
+		      const G4int *count = 0 );
+  G4String CheckpointName() const;
+  void     MergeEventFiles( const G4String &name, size_t nparts ) const;
+  void     MergeShards( const std::vector<G4String> &shards );
+  void     OpenOutputFile();
+  void     RecoverOutputFile();
+  G4String ShardName( G4int index, char kind ) const;
+  std::vector<G4String> ShardNames( G4int nshards, char kind ) const;
+  void     WriteCheckpoint( G4int nevents ) const;
+  void     WriteRunInfo() const;
+  void     WriteSelection() const;
+  void     WriteSlowEvents() const;
   
   // Attributes
   EMCalRunActionMessenger *fMessenger;
+  G4bool                   fBufferedOutput;
+  G4bool                   fFileCreated;
+  G4String                 fFileName;
+  G4int                    fFlushEntries;
   TFile                   *fOutputFile;
   TTree                   *fOutputTree;
   G4String                 fTreeName;
+  G4double                 fGateLength;
+  G4double                 fGateStart;
+  G4int                    fProfileBins;
+  G4bool                   fRecordSteps;
   EMCalRun                *fRun;
+  EMCalSteppingAction     *fSteppingAction;
+  TTree                   *fStepTree;
+  G4double                 fTimeBinWidth;
+  G4RunManager::RMType     fRunManagerType;
+  EMCalOutputWriter       *fWriter;
+  G4int                    fWriterQueue;
+  G4bool                   fWritingBuffer;
 
-};
+  // Seed of the run, from which the seeds of each event are computed, and number of
+  // the first event. They are set by the master before the workers start the run.
+  G4int                    fFirstEvent;
+  G4long                   fSeed;
+  static G4int             fRunFirstEvent;
+  static G4long            fRunSeed;
 
-// Creates a new Root file
-inline void EMCalRunAction::CreateNewFile( const G4String name ) {
+  // Number of processes forked to simulate the events, and index of this process. It
+  // is negative if the process has not been forked.
+  G4int                    fNprocesses;
+  G4int                    fProcessIndex;
 
-  if ( fOutputFile )
-    fOutputFile -> Close();
+  // Whether the runs write a checkpoint to be resumed if they are interrupted, number
+  // of files recovered from an interrupted run, and numbers of the events which remain
+  // to be simulated when it is resumed
+  G4bool                   fCheckpoint;
+  G4int                    fNrecovered;
+  static std::vector<G4int> fPendingEvents;
 
-  fOutputFile = TFile::Open( name.data(), "RECREATE" );
+  // Criteria to select the events to be simulated again, and file where their numbers
+  // and seeds are written. If the file name is empty no events are selected.
+  G4double                 fSelectLeakage;
+  G4int                    fSelectModules;
+  G4String                 fSelectionFile;
 
-  G4cout << " Created new file with name <" << name << ">" << G4endl;
+  // File where the events taking more time than the threshold of the event action
+  // are written. If empty they are not written.
+  G4String                 fSlowEventFile;
+
+  // Meter of the progress of the runs, fed by all the threads. It is owned by the run
+  // action of the master, or by that of the sequential run manager.
+  EMCalProgressMeter      *fProgressMeter;
+
+#ifdef EMCAL_BUFFER_MERGER
+  // File of this worker, whose contents are sent to the merger shared by all the
+  // threads, which is owned by the master
+  std::shared_ptr<EMCalBufferMergerFile> fMergerFile;
+  static EMCalBufferMerger              *fBufferMerger;
+#endif
+
+};
+
+// Sets whether the next runs write a checkpoint, so they can be resumed if they are
+// interrupted
+inline void EMCalRunAction::SetCheckpoint( G4bool checkpoint ) {
+  fCheckpoint = checkpoint;
+  G4cout << " Checkpoint of the runs set to <" << checkpoint << ">" << G4endl;
+}
+// Sets the number of the first event of the next runs. The events of a run can be
+// simulated again by setting the same seed and the number of the first event.
+inline void EMCalRunAction::SetFirstEvent( G4int first ) {
+  fFirstEvent = first;
+  G4cout << " Number of the first event set to <" << first << ">" << G4endl;
+}
+// Sets the number of entries after which the output trees are saved. When the output
+// is buffered, the entries are sent to be merged in the output file.
+inline void EMCalRunAction::SetFlushEntries( G4int entries ) {
+  fFlushEntries = entries;
+  G4cout << " Number of entries to flush the output set to <" << entries << ">" << G4endl;
+}
+// Sets the length of the gate where the pulses of the modules are integrated
+inline void EMCalRunAction::SetGateLength( G4double length ) {
+  fGateLength = length;
+  G4cout << " Gate length set to <" << G4BestUnit( length, "Time" ) << ">" << G4endl;
+}
+// Sets the start of the gate where the pulses of the modules are integrated
+inline void EMCalRunAction::SetGateStart( G4double start ) {
+  fGateStart = start;
+  G4cout << " Gate start set to <" << G4BestUnit( start, "Time" ) << ">" << G4endl;
 }
 // Gets the output tree class attached to the class ( the current writing tree )
 inline TTree* EMCalRunAction::GetOutputTree() { return fOutputTree; }
@@ -79,6 +217,70 @@ inline void EMCalRunAction::SetOutputTreeName( G4String name ) {
   fTreeName = name;
   G4cout << " Output tree name changed to <" << name << ">" << G4endl;
 }
+// Sets the number of processes forked by < ForkBeamOn >
+inline void EMCalRunAction::SetProcesses( G4int nprocesses ) {
+  fNprocesses = nprocesses;
+  G4cout << " Number of processes set to <" << nprocesses << ">" << G4endl;
+}
+// Sets the number of bins of the shower profiles. If zero they are not filled.
+inline void EMCalRunAction::SetProfileBins( G4int nbins ) {
+  fProfileBins = nbins;
+  G4cout << " Number of bins of the shower profiles set to <" << nbins << ">" << G4endl;
+}
+// Sets whether the steps depositing energy in the modules are written to the file
+inline void EMCalRunAction::SetRecordSteps( G4bool record ) {
+  fRecordSteps = record;
+  G4cout << " Recording of the steps set to <" << record << ">" << G4endl;
+  if ( record && fWriterQueue > 0 )
+    G4cout << "WARNING: The writer queue set by /EMCal/run/setWriterQueue is ignored "
+	   << "while the steps are recorded" << G4endl;
+}
+// Sets the seed of the next runs. If zero, the seed of each run is taken from the
+// random engine of the master.
+inline void EMCalRunAction::SetSeed( G4long seed ) {
+  fSeed = seed;
+  G4cout << " Seed of the runs set to <" << seed << ">" << G4endl;
+}
+// Sets the minimum fraction of the energy lost for an event to be selected. If zero
+// the criterion is not applied.
+inline void EMCalRunAction::SetSelectLeakage( G4double fraction ) {
+  fSelectLeakage = fraction;
+  G4cout << " Leakage to select the events set to <" << fraction << ">" << G4endl;
+}
+// Sets the minimum number of modules with energy deposited for an event to be
+// selected. If zero the criterion is not applied.
+inline void EMCalRunAction::SetSelectModules( G4int nmodules ) {
+  fSelectModules = nmodules;
+  G4cout << " Number of modules to select the events set to <" << nmodules << ">" << G4endl;
+}
+// Sets the file where the selected events are written. If empty, no events are
+// selected.
+inline void EMCalRunAction::SetSelectionFile( G4String name ) {
+  fSelectionFile = name;
+  G4cout << " Selection file set to <" << name << ">" << G4endl;
+}
+// Sets the file where the events taking more time than the threshold are written. If
+// empty, they are not written.
+inline void EMCalRunAction::SetSlowEventFile( G4String name ) {
+  fSlowEventFile = name;
+  G4cout << " Slow event file set to <" << name << ">" << G4endl;
+}
+// Sets the width of the time bins of the pulses of the modules. If zero the energy
+// is not binned in time.
+inline void EMCalRunAction::SetTimeBinWidth( G4double width ) {
+  fTimeBinWidth = width;
+  G4cout << " Width of the time bins set to <" << G4BestUnit( width, "Time" ) << ">" << G4endl;
+}
+
+// Sets the number of events in the queue of the thread writing the output tree. If
+// zero the tree is filled by the simulation thread.
+inline void EMCalRunAction::SetWriterQueue( G4int capacity ) {
+  fWriterQueue = capacity;
+  G4cout << " Capacity of the writer queue set to <" << capacity << ">" << G4endl;
+  if ( capacity > 0 && fRecordSteps )
+    G4cout << "WARNING: The writer queue is ignored while the steps are recorded. "
+	   << "Disable /EMCal/run/recordSteps to use it." << G4endl;
+}
 
 #endif
 
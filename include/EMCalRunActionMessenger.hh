@@ -25,6 +25,11 @@
 #include "G4UImessenger.hh"
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithoutParameter.hh"
 #include "globals.hh"
 
 
@@ -44,10 +49,30 @@ public:
 protected:
 
   // Attributes
-  EMCalRunAction     *fRunAction;
-  G4UIdirectory      *fRunDir;
-  G4UIcmdWithAString *fOutputFileNameCmd;
-  G4UIcmdWithAString *fOutputTreeNameCmd;
+  EMCalRunAction            *fRunAction;
+  G4UIdirectory             *fRunDir;
+  G4UIcmdWithABool          *fCheckpointCmd;
+  G4UIcmdWithAnInteger      *fFirstEventCmd;
+  G4UIcmdWithAnInteger      *fForkBeamOnCmd;
+  G4UIcmdWithAnInteger      *fFlushEntriesCmd;
+  G4UIcmdWithADoubleAndUnit *fGateLengthCmd;
+  G4UIcmdWithADoubleAndUnit *fGateStartCmd;
+  G4UIcmdWithAString        *fOutputFileNameCmd;
+  G4UIcmdWithAString        *fOutputModeCmd;
+  G4UIcmdWithAString        *fOutputTreeNameCmd;
+  G4UIcmdWithAnInteger      *fProcessesCmd;
+  G4UIcmdWithAnInteger      *fProfileBinsCmd;
+  G4UIcmdWithADoubleAndUnit *fProgressIntervalCmd;
+  G4UIcmdWithABool          *fRecordStepsCmd;
+  G4UIcmdWithoutParameter   *fResumeCmd;
+  G4UIcmdWithAString        *fReplayCmd;
+  G4UIcmdWithADouble        *fSelectLeakageCmd;
+  G4UIcmdWithAnInteger      *fSelectModulesCmd;
+  G4UIcmdWithAString        *fSelectionFileCmd;
+  G4UIcmdWithAnInteger      *fSeedCmd;
+  G4UIcmdWithAString        *fSlowEventFileCmd;
+  G4UIcmdWithADoubleAndUnit *fTimeBinWidthCmd;
+  G4UIcmdWithAnInteger      *fWriterQueueCmd;
 };
 
 #endif
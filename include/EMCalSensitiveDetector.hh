@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SensitiveDetector class. It is attached to the detector and      //
+//  shower-generator volumes when the scoring is done through sensitive          //
+//  detectors, and creates one hit for each volume with energy deposited in an   //
+//  event.                                                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalSensitiveDetector_h
+#define EMCalSensitiveDetector_h 1
+
+#include "EMCalHit.hh"
+
+#include "G4VSensitiveDetector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class EMCalDetectorConstruction;
+class EMCalRun;
+class G4HCofThisEvent;
+class G4Step;
+class G4TouchableHistory;
+
+
+//_______________________________________________________________________________
+
+class EMCalSensitiveDetector : public G4VSensitiveDetector {
+
+public:
+
+  // Constructor and destructor
+  EMCalSensitiveDetector( const G4String                  &name,
+			  const EMCalDetectorConstruction *detector );
+  virtual ~EMCalSensitiveDetector();
+
+  // Methods
+  virtual void   EndOfEvent( G4HCofThisEvent *hce );
+  virtual void   Initialize( G4HCofThisEvent *hce );
+  virtual G4bool ProcessHits( G4Step *step, G4TouchableHistory *history );
+
+protected:
+
+  // Attributes
+  const EMCalDetectorConstruction *fDetector;
+  EMCalHitsCollection             *fHitsCollection;
+  G4int                            fHitsCollectionID;
+  std::vector<G4int>               fHitIndex;
+  EMCalRun                        *fRun;
+};
+
+#endif
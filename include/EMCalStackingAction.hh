@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the StackingAction class. The tracks created out of the envelope of  //
+//  the modules which can not reach it are killed, if requested. If the events   //
+//  are divided in sub-events, the secondary tracks with energy above the        //
+//  threshold are grouped and sent to the other worker threads instead of being  //
+//  stacked. When the stack of the event is empty, the groups which no other     //
+//  thread has taken are given back to it. The number of tracks in the stack can //
+//  be limited. The tracks above the limit are saved in a compact form, and they //
+//  are stacked again when the stack is empty, the last ones first or the ones   //
+//  with less energy first.                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalStackingAction_h
+#define EMCalStackingAction_h 1
+
+#include "EMCalSubEvent.hh"
+#include "EMCalSubEventScheduler.hh"
+
+#include "G4UserStackingAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalDetectorConstruction;
+class EMCalRun;
+class EMCalStackingActionMessenger;
+
+class EMCalStackingAction : public G4UserStackingAction {
+
+public:
+
+  // Constructor and destructor
+  EMCalStackingAction();
+  virtual ~EMCalStackingAction();
+
+  // Orders to stack again the tracks saved out of the stack
+  enum StackOrder { kDepth, kEnergy };
+
+  // Methods
+  virtual G4ClassificationOfNewTrack ClassifyNewTrack( const G4Track *track );
+  virtual void                       NewStage();
+  virtual void                       PrepareNewEvent();
+  inline void                        SetMaxSaved( G4int ntracks );
+  inline void                        SetMaxTracks( G4int ntracks );
+  void                               SetOrder( G4String order );
+
+protected:
+
+  // Methods
+  void ClearReclaimed();
+  void RestoreTracks();
+  void SaveTrack( const G4Track *track );
+
+  // Attributes
+  const EMCalDetectorConstruction  *fDetector;
+  G4bool                            fKillEscaping;
+  EMCalStackingActionMessenger     *fMessenger;
+  G4double                          fMinEnergy;
+  G4bool                            fOffloading;
+  G4int                             fOwner;
+  G4ThreeVector                     fPrimaryDirection;
+  G4ThreeVector                     fPrimaryOrigin;
+  EMCalSubEventScheduler           *fScheduler;
+  EMCalSubEvent                    *fSubEvent;
+  G4double                          fSubEventEnergy;
+
+  // Number of the current event and of the sub-events created by it, and sub-events
+  // not taken by other threads, which are processed one after the other by this
+  // thread with their own seeds
+  G4int                             fEventNumber;
+  G4int                             fNsubEvents;
+  std::vector<EMCalSubEvent*>       fReclaimed;
+
+  // Maximum number of tracks in the stack and saved out of it, or zero if there is
+  // no limit, order to stack again the tracks above it and tracks saved out of the
+  // stack. The tracks being stacked again are not saved. Once the maximum number of
+  // saved tracks is reached, the new ones stay in the stack.
+  size_t                            fMaxSaved;
+  size_t                            fMaxTracks;
+  StackOrder                        fOrder;
+  std::vector<EMCalSubEvent::Track> fOverflow;
+  G4bool                            fRestoring;
+  EMCalRun                         *fRun;
+  G4bool                            fSavedFull;
+};
+
+// Sets the maximum number of tracks saved out of the stack. If zero there is no limit.
+inline void EMCalStackingAction::SetMaxSaved( G4int ntracks ) {
+  fMaxSaved = ntracks;
+  G4cout << " Maximum number of saved tracks set to <" << ntracks << ">" << G4endl;
+}
+
+// Sets the maximum number of tracks in the stack. If zero there is no limit.
+inline void EMCalStackingAction::SetMaxTracks( G4int ntracks ) {
+  fMaxTracks = ntracks;
+  G4cout << " Maximum number of stacked tracks set to <" << ntracks << ">" << G4endl;
+}
+
+#endif
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the StackingAction class, which has control of the  //
+//  maximum number of tracks in the stack and of the order to stack again the    //
+//  tracks above it.                                                             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalStackingActionMessenger_h
+#define EMCalStackingActionMessenger_h 1
+
+#include "EMCalStackingAction.hh"
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithAString.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalStackingActionMessenger: public G4UImessenger {
+
+public:
+
+  // Constructor and destructor
+  EMCalStackingActionMessenger( EMCalStackingAction *stackingAction );
+  ~EMCalStackingActionMessenger();
+
+  // Method
+  void SetNewValue( G4UIcommand *command, G4String value );
+
+protected:
+
+  // Attributes
+  EMCalStackingAction  *fStackingAction;
+  G4UIdirectory        *fStackDir;
+  G4UIcmdWithAnInteger *fMaxTracksCmd;
+  G4UIcmdWithAnInteger *fMaxSavedCmd;
+  G4UIcmdWithAString   *fOrderCmd;
+
+};
+
+#endif
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the StepHit class. Each step hit contains the information of one     //
+//  step that deposited energy in a module ( position in the frame of the volume,//
+//  time, energy and particle ), so the response of the detector can be computed //
+//  again without simulating the showers. The hits are allocated from a pool of  //
+//  each thread.                                                                 //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalStepHit_h
+#define EMCalStepHit_h 1
+
+#include "EMCalDetectorConstruction.hh"
+
+#include "G4VHit.hh"
+#include "G4THitsCollection.hh"
+#include "G4Allocator.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalStepHit : public G4VHit {
+
+public:
+
+  // Constructor and destructor
+  EMCalStepHit( G4int                                 module,
+		EMCalDetectorConstruction::VolumeType type,
+		const G4ThreeVector                  &position,
+		G4double                              time,
+		G4double                              energy,
+		G4int                                 pdg );
+  virtual ~EMCalStepHit();
+
+  // Memory management through the step hit allocator
+  inline void* operator new( size_t );
+  inline void  operator delete( void *hit );
+
+  // Methods
+  inline G4double                              GetEnergy() const;
+  inline const G4ThreeVector&                  GetLocalPosition() const;
+  inline G4int                                 GetModule() const;
+  inline G4int                                 GetPDG() const;
+  inline G4double                              GetTime() const;
+  inline EMCalDetectorConstruction::VolumeType GetType() const;
+
+protected:
+
+  // Attributes
+  G4double                              fEnergy;
+  G4ThreeVector                         fLocalPosition;
+  G4int                                 fModule;
+  G4int                                 fPDG;
+  G4double                              fTime;
+  EMCalDetectorConstruction::VolumeType fType;
+};
+
+typedef G4THitsCollection<EMCalStepHit> EMCalStepHitsCollection;
+
+extern G4ThreadLocal G4Allocator<EMCalStepHit> *EMCalStepHitAllocator;
+
+// Allocates a new step hit from the allocator of this thread
+inline void* EMCalStepHit::operator new( size_t ) {
+  if ( !EMCalStepHitAllocator )
+    EMCalStepHitAllocator = new G4Allocator<EMCalStepHit>;
+  return (void*) EMCalStepHitAllocator -> MallocSingle();
+}
+// Returns the step hit to the allocator of this thread
+inline void EMCalStepHit::operator delete( void *hit ) {
+  EMCalStepHitAllocator -> FreeSingle( (EMCalStepHit*) hit );
+}
+// Returns the attributes of the step hit
+inline G4double             EMCalStepHit::GetEnergy()        const { return fEnergy;        }
+inline const G4ThreeVector& EMCalStepHit::GetLocalPosition() const { return fLocalPosition; }
+inline G4int                EMCalStepHit::GetModule()        const { return fModule;        }
+inline G4int                EMCalStepHit::GetPDG()           const { return fPDG;           }
+inline G4double             EMCalStepHit::GetTime()          const { return fTime;          }
+inline EMCalDetectorConstruction::VolumeType EMCalStepHit::GetType() const { return fType; }
+
+#endif
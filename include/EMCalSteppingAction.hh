@@ -25,6 +25,7 @@
 
 #include <vector>
 
+class EMCalDetectorConstruction;
 class EMCalEventAction;
 class G4LogicalVolume;
 
@@ -39,13 +40,25 @@ public:
   EMCalSteppingAction(EMCalEventAction* eventAction);
   virtual ~EMCalSteppingAction();
 
-  // Method
+  // Methods
+  void         SelectKernel( G4bool sgv, G4bool grid, G4bool options );
   virtual void UserSteppingAction(const G4Step*);
 
 private:
 
-  // Attribute
-  EMCalEventAction              *fEventAction;
+  // Kernel to score the energy deposited in a step
+  template<G4bool sgv, G4bool grid, G4bool options> void Score( const G4Step *step );
+  void KillEscaping( const G4Step *step );
+  typedef void ( EMCalSteppingAction::*ScoringKernel )( const G4Step* );
+  template<G4bool options> ScoringKernel SelectGeometry( G4bool sgv, G4bool grid );
+
+  // Attributes
+  const EMCalDetectorConstruction *fDetector;
+  const G4LogicalVolume           *fSingleDetector;
+  const G4LogicalVolume           *fSingleSGVolume;
+  EMCalEventAction                *fEventAction;
+  ScoringKernel                    fKernel;
+  G4bool                           fKillEscaping;
 };
 
 #endif
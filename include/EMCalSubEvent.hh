@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SubEvent class. It holds a group of secondary tracks of an event //
+//  which are simulated by another worker thread, so the tracks of an event with //
+//  a large energy are shared among the threads. The thread processing the sub-  //
+//  event converts the tracks into primary particles, and saves the energy       //
+//  deposited in the modules, which is added to that of the event before it is   //
+//  filled.                                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalSubEvent_h
+#define EMCalSubEvent_h 1
+
+#include "G4Event.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4StackManager.hh"
+#include "G4ThreeVector.hh"
+#include "G4Track.hh"
+#include "globals.hh"
+
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalSubEvent {
+
+public:
+
+  // Constructor and destructor. The owner is the thread processing the event, whose
+  // number is < evtNb >, and < index > is the position of the sub-event among those
+  // created by the event.
+  EMCalSubEvent( G4int                owner,
+		 G4int                evtNb,
+		 G4int                index,
+		 const G4ThreeVector &origin,
+		 const G4ThreeVector &direction );
+  ~EMCalSubEvent();
+
+  // Nested struct with the energy deposited by the sub-event in a module
+  struct Module {
+
+    size_t   Index;
+    G4double DetectorEnergy;
+    G4double SGVolumeEnergy;
+    G4int    nDetInteractions;
+    G4int    nSgvInteractions;
+  };
+
+  // Nested struct with the state of a track when it was created
+  struct Track {
+
+    const G4ParticleDefinition *Particle;
+    G4double                    Energy;
+    G4double                    Time;
+    G4double                    Weight;
+    G4ThreeVector               Position;
+    G4ThreeVector               Direction;
+    G4ThreeVector               Polarization;
+    G4int                       TrackID;
+    G4int                       ParentID;
+  };
+
+  // Methods
+  inline void                           AddEscapedEnergy( G4double energy );
+  void                                  AddModule( size_t   idet,
+						   G4double detectorEnergy,
+						   G4double sgvEnergy,
+						   G4int    ndet,
+						   G4int    nsgv );
+  inline void                           AddQuenchedEnergy( G4double energy );
+  void                                  AddTrack( const G4Track *track );
+  G4Event*                              BuildEvent( G4int eventID ) const;
+  inline G4double                       GetCpuTime() const;
+  static inline EMCalSubEvent*          GetCurrent();
+  inline G4double                       GetEnergy() const;
+  inline G4double                       GetEscapedEnergy() const;
+  inline G4int                          GetEventNumber() const;
+  inline G4int                          GetIndex() const;
+  inline const std::vector<Module>&     GetModules() const;
+  inline size_t                         GetNtracks() const;
+  inline G4int                          GetOwner() const;
+  inline const G4ThreeVector&           GetPrimaryDirection() const;
+  inline const G4ThreeVector&           GetPrimaryOrigin() const;
+  inline G4double                       GetQuenchedEnergy() const;
+  inline G4bool                         IsDone() const;
+  static G4Track*                       MakeTrack( const Track &state );
+  void                                  PushTracks( G4StackManager *stackManager ) const;
+  void                                  SeedRandom() const;
+  static Track                          SaveTrack( const G4Track *track );
+  inline void                           SetCpuTime( G4double time );
+  static inline void                    SetCurrent( EMCalSubEvent *subEvent );
+  inline void                           SetDone();
+
+protected:
+
+  // Attributes
+  G4double            fCpuTime;
+  G4bool              fDone;
+  G4double            fEnergy;
+  G4double            fEscapedEnergy;
+  G4int               fEventNumber;
+  G4int               fIndex;
+  std::vector<Module> fModules;
+  G4int               fOwner;
+  G4ThreeVector       fPrimaryDirection;
+  G4ThreeVector       fPrimaryOrigin;
+  G4double            fQuenchedEnergy;
+  std::vector<Track>  fTracks;
+
+  // Sub-event being processed by the current thread. It is null if the thread is
+  // processing one of its own events.
+  static G4ThreadLocal EMCalSubEvent *fCurrent;
+};
+
+// Adds energy of the tracks of the sub-event killed out of the envelope of the modules
+inline void EMCalSubEvent::AddEscapedEnergy( G4double energy ) { fEscapedEnergy += energy; }
+// Adds visible energy deposited by the sub-event
+inline void EMCalSubEvent::AddQuenchedEnergy( G4double energy ) { fQuenchedEnergy += energy; }
+// Returns the CPU time, in seconds, taken by the thread which processed the sub-event
+inline G4double EMCalSubEvent::GetCpuTime() const { return fCpuTime; }
+// Returns the sub-event being processed by the current thread
+inline EMCalSubEvent* EMCalSubEvent::GetCurrent() { return fCurrent; }
+// Returns the sum of the kinetic energies of the tracks
+inline G4double EMCalSubEvent::GetEnergy() const { return fEnergy; }
+// Returns the energy of the tracks killed out of the envelope of the modules
+inline G4double EMCalSubEvent::GetEscapedEnergy() const { return fEscapedEnergy; }
+// Returns the number of the event which created the sub-event
+inline G4int EMCalSubEvent::GetEventNumber() const { return fEventNumber; }
+// Returns the position of the sub-event among those created by its event
+inline G4int EMCalSubEvent::GetIndex() const { return fIndex; }
+// Returns the modules with energy deposited by the sub-event
+inline const std::vector<EMCalSubEvent::Module>& EMCalSubEvent::GetModules() const {
+  return fModules;
+}
+// Returns the number of tracks of the sub-event
+inline size_t EMCalSubEvent::GetNtracks() const { return fTracks.size(); }
+// Returns the thread processing the event which created the sub-event
+inline G4int EMCalSubEvent::GetOwner() const { return fOwner; }
+// Returns the direction of the primary particle of the event
+inline const G4ThreeVector& EMCalSubEvent::GetPrimaryDirection() const { return fPrimaryDirection; }
+// Returns the origin of the primary particle of the event
+inline const G4ThreeVector& EMCalSubEvent::GetPrimaryOrigin() const { return fPrimaryOrigin; }
+// Returns the visible energy deposited by the sub-event
+inline G4double EMCalSubEvent::GetQuenchedEnergy() const { return fQuenchedEnergy; }
+// Returns whether the sub-event has been processed
+inline G4bool EMCalSubEvent::IsDone() const { return fDone; }
+// Sets the CPU time, in seconds, taken to process the sub-event
+inline void EMCalSubEvent::SetCpuTime( G4double time ) { fCpuTime = time; }
+// Sets the sub-event being processed by the current thread
+inline void EMCalSubEvent::SetCurrent( EMCalSubEvent *subEvent ) { fCurrent = subEvent; }
+// Marks the sub-event as processed
+inline void EMCalSubEvent::SetDone() { fDone = true; }
+
+#endif
@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SubEventScheduler class. It shares the sub-events among the      //
+//  worker threads of the multithreaded run manager. A thread processing an event//
+//  with a large energy submits groups of its secondary tracks as sub-events,    //
+//  which are taken by the threads which have finished their own events. When the//
+//  thread has no more tracks, it takes back the sub-events which were not taken,//
+//  and waits for the rest before filling the event. Tracks are only sent to     //
+//  other threads if their energy is above the threshold set by the user, and    //
+//  they are grouped until their energy reaches the size of the sub-events.      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalSubEventScheduler_h
+#define EMCalSubEventScheduler_h 1
+
+#include "EMCalSubEvent.hh"
+
+#include "G4UnitsTable.hh"
+#include "globals.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalSubEventScheduler {
+
+public:
+
+  // Constructor and destructor
+  EMCalSubEventScheduler();
+  ~EMCalSubEventScheduler();
+
+  // Methods
+  std::vector<EMCalSubEvent*>    Collect( G4int owner );
+  void                           Complete( EMCalSubEvent *subEvent );
+  inline G4bool                  Enabled() const;
+  void                           FinishEvents();
+  static EMCalSubEventScheduler* GetInstance();
+  inline G4double                GetMinEnergy() const;
+  inline G4double                GetSubEventEnergy() const;
+  EMCalSubEvent*                 Next( G4bool wait );
+  void                           PrintStatistics() const;
+  std::vector<EMCalSubEvent*>    Reclaim( G4int owner );
+  inline void                    SetMinEnergy( G4double energy );
+  inline void                    SetSubEventEnergy( G4double energy );
+  void                           StartRun( G4int nthreads );
+  void                           Submit( EMCalSubEvent *subEvent );
+
+protected:
+
+  // Attributes
+  std::condition_variable                    fCondition;
+  G4double                                   fMinEnergy;
+  std::mutex                                 fMutex;
+  std::deque<EMCalSubEvent*>                 fQueue;
+  G4double                                   fSubEventEnergy;
+
+  // Sub-events submitted by each thread in its current event, and number of threads
+  // with sub-events and of threads which still have events to process. While any of
+  // them is not zero, the threads without events wait for new sub-events.
+  std::vector<G4int>                         fOwnerActive;
+  std::vector< std::vector<EMCalSubEvent*> > fSubmitted;
+  G4int                                      fNactiveOwners;
+  G4int                                      fNworkersWithEvents;
+
+  // Statistics of the run
+  G4long                                     fNprocessed;
+  G4long                                     fNreclaimed;
+  G4long                                     fNsubmitted;
+  G4long                                     fNtracks;
+
+  // Scheduler of the run manager, shared by all the threads
+  static EMCalSubEventScheduler             *fInstance;
+};
+
+// Returns whether the tracks are sent to other threads
+inline G4bool EMCalSubEventScheduler::Enabled() const { return fMinEnergy > 0; }
+// Returns the minimum kinetic energy of a track to be sent to another thread
+inline G4double EMCalSubEventScheduler::GetMinEnergy() const { return fMinEnergy; }
+// Returns the energy of the tracks grouped in a sub-event
+inline G4double EMCalSubEventScheduler::GetSubEventEnergy() const { return fSubEventEnergy; }
+// Sets the minimum kinetic energy of a track to be sent to another thread. If zero
+// the events are not divided.
+inline void EMCalSubEventScheduler::SetMinEnergy( G4double energy ) {
+  fMinEnergy = energy;
+  G4cout << " Minimum energy of the tracks of the sub-events set to <"
+	 << G4BestUnit( energy, "Energy" ) << ">" << G4endl;
+}
+// Sets the energy of the tracks grouped in a sub-event
+inline void EMCalSubEventScheduler::SetSubEventEnergy( G4double energy ) {
+  fSubEventEnergy = energy;
+  G4cout << " Energy of the sub-events set to <" << G4BestUnit( energy, "Energy" ) << ">" << G4endl;
+}
+
+#endif
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the TrackingAction class. It adds the steps of each track to those of//
+//  the current event, which are given to the progress meter at the end of the   //
+//  event. They are counted once per track, so nothing is done at each step.     //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalTrackingAction_h
+#define EMCalTrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalEventAction;
+
+class EMCalTrackingAction : public G4UserTrackingAction {
+
+public:
+
+  // Constructor and destructor
+  EMCalTrackingAction( EMCalEventAction *eventAction );
+  virtual ~EMCalTrackingAction();
+
+  // Method
+  virtual void PostUserTrackingAction( const G4Track *track );
+
+protected:
+
+  // Attribute
+  EMCalEventAction *fEventAction;
+
+};
+
+#endif
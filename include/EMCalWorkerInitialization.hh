@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerInitialization class. When a worker thread starts, it pins //
+//  it to the processors of the machine following the layout set by the user,    //
+//  taking into account the NUMA nodes read from the system. With < compact > the//
+//  workers fill the processors of a node before using the next one, with <      //
+//  scatter > they are distributed among the nodes, and with < node > each worker//
+//  can run on any processor of the node assigned to it. The structures of each  //
+//  thread are allocated and set to zero by the thread itself once it is pinned, //
+//  so the memory is placed in its node. The layout can also be given through the//
+//  environment variable EMCAL_PINNING.                                          //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalWorkerInitialization_h
+#define EMCalWorkerInitialization_h 1
+
+#include "G4UserWorkerInitialization.hh"
+#include "globals.hh"
+
+#include <vector>
+
+
+//_______________________________________________________________________________
+
+class EMCalWorkerInitializationMessenger;
+
+class EMCalWorkerInitialization : public G4UserWorkerInitialization {
+
+public:
+
+  // Constructor and destructor
+  EMCalWorkerInitialization();
+  virtual ~EMCalWorkerInitialization();
+
+  // Methods
+  void         SetPinning( G4String layout );
+  virtual void WorkerInitialize() const;
+
+protected:
+
+  // Method
+  void ReadTopology();
+
+  // Attributes. The processors of each node are those where the program is allowed
+  // to run.
+  EMCalWorkerInitializationMessenger *fMessenger;
+  std::vector< std::vector<G4int> >   fNodes;
+  G4String                            fPinning;
+};
+
+#endif
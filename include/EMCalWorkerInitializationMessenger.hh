@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the WorkerInitialization class, to set the layout   //
+//  used to pin the worker threads to the processors.                            //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef EMCalWorkerInitializationMessenger_h
+#define EMCalWorkerInitializationMessenger_h 1
+
+#include "EMCalWorkerInitialization.hh"
+
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalWorkerInitializationMessenger: public G4UImessenger {
+
+public:
+
+  // Constructor and destructor
+  EMCalWorkerInitializationMessenger( EMCalWorkerInitialization *workerInit );
+  ~EMCalWorkerInitializationMessenger();
+
+  // Method
+  void SetNewValue( G4UIcommand *command, G4String value );
+
+protected:
+
+  // Attributes
+  EMCalWorkerInitialization *fWorkerInit;
+  G4UIdirectory             *fThreadsDir;
+  G4UIcmdWithAString        *fPinningCmd;
+
+};
+
+#endif
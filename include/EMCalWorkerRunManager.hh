@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerRunManager class. It is the run manager of each worker     //
+//  thread of the multithreaded run manager. Besides the events given by the     //
+//  master, it processes the sub-events submitted by the other workers. These    //
+//  have priority over new events, so the events which created them finish       //
+//  earlier, and once the worker has no more events it waits for new sub-events  //
+//  until all the workers have finished.                                         //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#ifndef EMCalWorkerRunManager_h
+#define EMCalWorkerRunManager_h 1
+
+#include "EMCalSubEventScheduler.hh"
+
+#include "G4WorkerRunManager.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalWorkerRunManager : public G4WorkerRunManager {
+
+public:
+
+  // Constructor and destructor
+  EMCalWorkerRunManager();
+  virtual ~EMCalWorkerRunManager();
+
+  // Method
+  virtual void InitializeEventLoop( G4int n_event, const char *macroFile = 0, G4int n_select = -1 );
+
+protected:
+
+  // Method
+  virtual G4Event* GenerateEvent( G4int i_event );
+
+  // Attributes
+  G4bool                  fHasEvents;
+  G4int                   fNsubEvents;
+  EMCalSubEventScheduler *fScheduler;
+};
+
+#endif
+
+#endif
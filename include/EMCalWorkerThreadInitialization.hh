@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerThreadInitialization class. It creates the run manager of  //
+//  each worker thread of the multithreaded run manager, which also processes the//
+//  sub-events of the other workers.                                             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#ifndef EMCalWorkerThreadInitialization_h
+#define EMCalWorkerThreadInitialization_h 1
+
+#include "G4UserWorkerThreadInitialization.hh"
+#include "globals.hh"
+
+
+//_______________________________________________________________________________
+
+class EMCalWorkerThreadInitialization : public G4UserWorkerThreadInitialization {
+
+public:
+
+  // Constructor and destructor
+  EMCalWorkerThreadInitialization();
+  virtual ~EMCalWorkerThreadInitialization();
+
+  // Method
+  virtual G4WorkerRunManager* CreateWorkerRunManager() const;
+};
+
+#endif
+
+#endif
@@ -22,7 +22,9 @@
 #include "EMCalPrimaryGeneratorAction.hh"
 #include "EMCalRunAction.hh"
 #include "EMCalEventAction.hh"
+#include "EMCalStackingAction.hh"
 #include "EMCalSteppingAction.hh"
+#include "EMCalTrackingAction.hh"
 
 
 //_______________________________________________________________________________
@@ -42,10 +44,19 @@ void EMCalActionInitialization::BuildForMaster() const { SetUserAction(new EMCal
 void EMCalActionInitialization::Build() const {
 
   SetUserAction( new EMCalPrimaryGeneratorAction );
-  SetUserAction( new EMCalRunAction );
   
   EMCalEventAction* eventAction = new EMCalEventAction;
   SetUserAction( eventAction );
 
-  SetUserAction( new EMCalSteppingAction( eventAction ) );
+  EMCalSteppingAction* steppingAction = new EMCalSteppingAction( eventAction );
+  SetUserAction( steppingAction );
+
+  // Counts the steps of the events for the progress meter
+  SetUserAction( new EMCalTrackingAction( eventAction ) );
+
+  // Sends the tracks of the events to other threads if the events are divided
+  SetUserAction( new EMCalStackingAction );
+
+  // The run action removes the stepping action if it is not used for scoring
+  SetUserAction( new EMCalRunAction( steppingAction ) );
 }
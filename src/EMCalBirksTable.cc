@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the BirksTable class. It gives the visible energy of the steps in a  //
+//  scintillator following Birks' law, dE_vis = dE/( 1 + kB*dE/dx ). The stopping//
+//  powers of electrons, positrons and protons are computed once at the beginning//
+//  of the run and stored as tables of the quenching factor versus the logarithm //
+//  of the kinetic energy, so each step only needs one table lookup. For other   //
+//  charged particles the stopping power is estimated from the step.             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalBirksTable.hh"
+
+#include "G4Electron.hh"
+#include "G4EmCalculator.hh"
+#include "G4Material.hh"
+#include "G4Positron.hh"
+#include "G4Proton.hh"
+#include "G4SystemOfUnits.hh"
+
+
+//_______________________________________________________________________________
+// Constructor. Until the tables are built the steps are not quenched.
+EMCalBirksTable::EMCalBirksTable() :
+  fBirks( 0 ),
+  fElectron( 0 ),
+  fElectronTable( 1, 1. ),
+  fInvDelta( 0 ),
+  fLogEmin( 0 ),
+  fPositron( 0 ),
+  fPositronTable( 1, 1. ),
+  fProton( 0 ),
+  fProtonTable( 1, 1. ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalBirksTable::~EMCalBirksTable() { }
+
+//_______________________________________________________________________________
+// Builds the tables of the quenching factor for the given material and Birks
+// constant. The electronic stopping powers are computed from 100 eV to 10 GeV,
+// with 40 points per decade. The physics tables must have been built, so this is
+// called at the beginning of the run.
+void EMCalBirksTable::Build( const G4Material *material, G4double birks ) {
+
+  const G4double emin = 100*eV, emax = 10*GeV;
+  const G4int    nbins = 8*40 + 1;
+
+  fBirks    = birks;
+  fLogEmin  = std::log( emin );
+  fInvDelta = ( nbins - 1 )/( std::log( emax ) - fLogEmin );
+
+  fElectron = G4Electron::Definition();
+  fPositron = G4Positron::Definition();
+  fProton   = G4Proton::Definition();
+
+  fElectronTable.resize( nbins );
+  fPositronTable.resize( nbins );
+  fProtonTable.resize( nbins );
+
+  G4EmCalculator calculator;
+  G4double       energy;
+  for ( G4int ibin = 0; ibin < nbins; ibin++ ) {
+
+    energy = std::exp( fLogEmin + ibin/fInvDelta );
+
+    fElectronTable[ ibin ] = 1./( 1. + birks*calculator.
+				  ComputeElectronicDEDX( energy, fElectron, material ) );
+    fPositronTable[ ibin ] = 1./( 1. + birks*calculator.
+				  ComputeElectronicDEDX( energy, fPositron, material ) );
+    fProtonTable[ ibin ]   = 1./( 1. + birks*calculator.
+				  ComputeElectronicDEDX( energy, fProton, material ) );
+  }
+
+  G4cout << " Built Birks tables for material <" << material -> GetName()
+	 << "> with kB = " << birks/( mm/MeV ) << " mm/MeV" << G4endl;
+}
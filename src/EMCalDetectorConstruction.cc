@@ -20,12 +20,15 @@
 
 #include "EMCalDetectorConstruction.hh"
 #include "EMCalDetectorMessenger.hh"
+#include "EMCalSensitiveDetector.hh"
 #include "EMCalSteppingAction.hh"
 
 #include "G4NistManager.hh"
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4SDManager.hh"
+#include "G4StateManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VisAttributes.hh"
 
@@ -59,9 +62,25 @@ EMCalDetectorConstruction::EMCalDetectorConstruction() :
   fNyModules = 3;
   fNzModules = 3;
 
+  // Number of readout sub-cells of the detectors in x-y-z axis
+  fNxSubCells = 1;
+  fNySubCells = 1;
+  fNzSubCells = 1;
+
   // Distance from the source to the detector
   fDistance = 7*m;
 
+  // By default the tracks are followed until they leave the world. If they are
+  // killed, the envelope is separated from the modules by this margin.
+  fEnvelopeMargin = 1*cm;
+  fKillEscaping   = false;
+
+  // By default the energy deposited in the detectors is not quenched
+  fBirksConstant = 0;
+
+  // By default the energy is scored by the stepping action
+  fScoringMode = kSteppingAction;
+
   // Enables by default the shower-generator volume
   fSGVolume = true;
 
@@ -72,6 +91,10 @@ EMCalDetectorConstruction::EMCalDetectorConstruction() :
   fDetectorColour = G4Colour( 0. , 0.6, 0.1, 0.85 );
   fSGVolumeColour = G4Colour( 0.6, 0.6, 0.6, 1.   );
 
+  // Volumes not belonging to any module
+  fOutsideInfo.Type   = kOutside;
+  fOutsideInfo.Module = -1;
+
   // Defines the materials
   this -> DefineMaterials();
 }
@@ -96,6 +119,7 @@ G4VPhysicalVolume* EMCalDetectorConstruction::Construct() {
   if ( fSGVolume )
     fSGVolumeArray = std::vector<G4LogicalVolume*>();
   fModuleArray.clear();
+  fVolumeTable.clear();
 
   // Get nist material manager
   G4NistManager *nist = G4NistManager::Instance();
@@ -159,6 +183,23 @@ G4VPhysicalVolume* EMCalDetectorConstruction::Construct() {
 
   G4ThreeVector sgvPosition, detPosition;
 
+  // The readout sub-cells divide each detector without creating new volumes. The
+  // positions in the frame of the detector are shifted to start at zero and scaled
+  // so the integer part is the sub-cell index in each axis.
+  fSubCellShift.set( detHalfLengthX, detHalfLengthY, detHalfLengthZ );
+  fSubCellScale.set( 0.5*fNxSubCells/detHalfLengthX,
+		     0.5*fNySubCells/detHalfLengthY,
+		     0.5*fNzSubCells/detHalfLengthZ );
+
+  // The envelope contains all the modules, from the front face of the calorimeter
+  // to its back, leaving the given margin
+  fEnvelopeMin.set( -fModuleHalfLengthX - fEnvelopeMargin,
+		    -fModuleHalfLengthY - fEnvelopeMargin,
+		    fDistance - fEnvelopeMargin );
+  fEnvelopeMax.set( fModuleHalfLengthX + fEnvelopeMargin,
+		    fModuleHalfLengthY + fEnvelopeMargin,
+		    fDistance + 2*fModuleHalfLengthZ + fEnvelopeMargin );
+
   EMCalModule *module;
 
   for ( G4int zdet = 0; zdet < fNzModules; zdet++ ) {
@@ -210,6 +251,9 @@ G4VPhysicalVolume* EMCalDetectorConstruction::Construct() {
 	module -> SetDetectorVisAttributes( new G4VisAttributes( fDetectorColour ) );
 
 	fDetectorArray.push_back( module -> GetLogicalDetector() );
+	this -> RegisterVolume( module -> GetLogicalDetector(),
+				kDetector,
+				fModuleArray.size() );
 
 	// If the shower-generator volume is enabled it is created
 	if ( fSGVolume ) {
@@ -235,6 +279,9 @@ G4VPhysicalVolume* EMCalDetectorConstruction::Construct() {
 	  module -> SetSGVolumeVisAttributes( new G4VisAttributes( fSGVolumeColour ) );
 
 	  fSGVolumeArray.push_back( module -> GetLogicalSGVolume() );
+	  this -> RegisterVolume( module -> GetLogicalSGVolume(),
+				  kSGVolume,
+				  fModuleArray.size() );
 	}
 
 	fModuleArray.push_back( module );
@@ -245,6 +292,71 @@ G4VPhysicalVolume* EMCalDetectorConstruction::Construct() {
   return physWorld;
 }
 
+//_______________________________________________________________________________
+// Attaches the sensitive detector of this thread to the detector and shower-generator
+// volumes, if the scoring is done through sensitive detectors. Otherwise it is
+// detached from them, so the energy is not scored twice if the mode was changed
+// without building the volumes again.
+void EMCalDetectorConstruction::ConstructSDandField() {
+
+  if ( fScoringMode != kSensitiveDetector ) {
+    for ( size_t idet = 0; idet < fDetectorArray.size(); idet++ )
+      fDetectorArray[ idet ] -> SetSensitiveDetector( 0 );
+    for ( size_t isgv = 0; isgv < fSGVolumeArray.size(); isgv++ )
+      fSGVolumeArray[ isgv ] -> SetSensitiveDetector( 0 );
+    return;
+  }
+
+  // The sensitive detector is created only once per thread
+  G4SDManager *sdManager = G4SDManager::GetSDMpointer();
+  G4VSensitiveDetector *sd = sdManager -> FindSensitiveDetector( "EMCalSD", false );
+  if ( !sd ) {
+    sd = new EMCalSensitiveDetector( "EMCalSD", this );
+    sdManager -> AddNewDetector( sd );
+  }
+
+  for ( size_t idet = 0; idet < fDetectorArray.size(); idet++ )
+    this -> SetSensitiveDetector( fDetectorArray[ idet ], sd );
+  if ( fSGVolume )
+    for ( size_t isgv = 0; isgv < fSGVolumeArray.size(); isgv++ )
+      this -> SetSensitiveDetector( fSGVolumeArray[ isgv ], sd );
+}
+
+//_______________________________________________________________________________
+// Attaches the role and the module index to the given logical volume
+void EMCalDetectorConstruction::RegisterVolume( const G4LogicalVolume *volume,
+						VolumeType             type,
+						G4int                  imod ) {
+
+  size_t id = volume -> GetInstanceID();
+  if ( id >= fVolumeTable.size() )
+    fVolumeTable.resize( id + 1, fOutsideInfo );
+
+  fVolumeTable[ id ].Type   = type;
+  fVolumeTable[ id ].Module = imod;
+}
+
+//_______________________________________________________________________________
+// Sets the way the energy deposited in the modules is scored. The sensitive
+// detectors are attached or detached when the geometry is built, so if it already
+// exists it must be updated.
+void EMCalDetectorConstruction::SetScoringMode( G4String mode ) {
+
+  if ( mode == "SteppingAction" )
+    fScoringMode = kSteppingAction;
+  else if ( mode == "SensitiveDetector" )
+    fScoringMode = kSensitiveDetector;
+  else {
+    G4cout << "Scoring mode <" << mode << "> not known" << G4endl;
+    return;
+  }
+
+  G4cout << " Scoring mode set to <" << mode << ">" << G4endl;
+  if ( G4StateManager::GetStateManager() -> GetCurrentState() == G4State_Idle )
+    G4cout << "WARNING: Apply /EMCal/detector/update to attach or detach the "
+	   << "sensitive detectors" << G4endl;
+}
+
 //_______________________________________________________________________________
 // Defines different materials
 void EMCalDetectorConstruction::DefineMaterials() { 
@@ -47,6 +47,15 @@ EMCalDetectorMessenger( EMCalDetectorConstruction *detector ) : fDetector( detec
   fDetectorMaterialCmd -> SetDefaultValue( "G4_SODIUM_IODIDE" );
   fDetectorMaterialCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
 
+  // Birks constant of the detector material, to compute the quenched energy
+  fBirksConstantCmd
+    = new G4UIcmdWithADouble( "/EMCal/detector/setBirksConstant", this );
+  fBirksConstantCmd -> SetGuidance( "Birks constant of the detector material in mm/MeV." );
+  fBirksConstantCmd -> SetGuidance( "If zero the quenched energy is not computed." );
+  fBirksConstantCmd -> SetParameterName( "BirksConstant", false );
+  fBirksConstantCmd -> SetRange( "BirksConstant >= 0" );
+  fBirksConstantCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
   // Distance from source
   fDistanceCmd
     = new G4UIcmdWithADoubleAndUnit( "/EMCal/detector/setDistance", this );
@@ -56,6 +65,26 @@ EMCalDetectorMessenger( EMCalDetectorConstruction *detector ) : fDetector( detec
   fDistanceCmd -> SetUnitCategory( "Length" );
   fDistanceCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
 
+  // Killing of the tracks escaping the modules
+  fKillEscapingCmd
+    = new G4UIcmdWithABool( "/EMCal/detector/killEscaping", this );
+  fKillEscapingCmd -> SetGuidance( "Kill the tracks out of the envelope of the modules" );
+  fKillEscapingCmd -> SetGuidance( "which can not reach it again in a straight line." );
+  fKillEscapingCmd -> SetGuidance( "Their energy is saved as escaped energy." );
+  fKillEscapingCmd -> SetGuidance( "The positrons are not killed, so their annihilation" );
+  fKillEscapingCmd -> SetGuidance( "photons are simulated." );
+  fKillEscapingCmd -> SetParameterName( "KillEscaping", false );
+  fKillEscapingCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fEnvelopeMarginCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/detector/setEnvelopeMargin", this );
+  fEnvelopeMarginCmd -> SetGuidance( "Distance from the modules to the envelope" );
+  fEnvelopeMarginCmd -> SetGuidance( "If changed in Idle state, \"update\" must be applied" );
+  fEnvelopeMarginCmd -> SetParameterName( "EnvelopeMargin", false );
+  fEnvelopeMarginCmd -> SetRange( "EnvelopeMargin >= 0" );
+  fEnvelopeMarginCmd -> SetUnitCategory( "Length" );
+  fEnvelopeMarginCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
   // Modules' size
   fModuleHalfLengthXcmd
     = new G4UIcmdWithADoubleAndUnit( "/EMCal/detector/setModuleHalfLengthX", this );
@@ -108,11 +137,43 @@ EMCalDetectorMessenger( EMCalDetectorConstruction *detector ) : fDetector( detec
   fNzModulesCmd -> SetParameterName( "NzModules", false );
   fNzModulesCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );  
 
+  // Number of readout sub-cells of the detectors in each direction
+  fNxSubCellsCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/detector/setNxSubCells", this );
+  fNxSubCellsCmd -> SetGuidance( "Set the number of X-readout sub-cells of each detector" );
+  fNxSubCellsCmd -> SetParameterName( "NxSubCells", false );
+  fNxSubCellsCmd -> SetRange( "NxSubCells > 0" );
+  fNxSubCellsCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );  
+
+  fNySubCellsCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/detector/setNySubCells", this );
+  fNySubCellsCmd -> SetGuidance( "Set the number of Y-readout sub-cells of each detector" );
+  fNySubCellsCmd -> SetParameterName( "NySubCells", false );
+  fNySubCellsCmd -> SetRange( "NySubCells > 0" );
+  fNySubCellsCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );  
+
+  fNzSubCellsCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/detector/setNzSubCells", this );
+  fNzSubCellsCmd -> SetGuidance( "Set the number of Z-readout sub-cells of each detector" );
+  fNzSubCellsCmd -> SetParameterName( "NzSubCells", false );
+  fNzSubCellsCmd -> SetRange( "NzSubCells > 0" );
+  fNzSubCellsCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );  
+
   // Print command
   fPrintCmd = new G4UIcmdWithoutParameter( "/EMCal/detector/printParameters", this );
   fPrintCmd -> SetGuidance("Prints geometry");
   fPrintCmd -> AvailableForStates( G4State_Idle );
 
+  // Scoring mode
+  fScoringModeCmd
+    = new G4UIcmdWithAString( "/EMCal/detector/setScoringMode", this );
+  fScoringModeCmd -> SetGuidance( "Select how the energy deposited is scored" );
+  fScoringModeCmd -> SetGuidance( "If changed in Idle state, \"update\" must be applied" );
+  fScoringModeCmd -> SetParameterName( "ScoringMode", false );
+  fScoringModeCmd -> SetCandidates( "SteppingAction SensitiveDetector" );
+  fScoringModeCmd -> SetDefaultValue( "SteppingAction" );
+  fScoringModeCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
   fSGVolumeCmd
     = new G4UIcmdWithABool( "/EMCal/detector/SGVenabled", this );
   fSGVolumeCmd -> SetGuidance( "Enable or disable the shower-generator volume" );
@@ -138,6 +199,8 @@ EMCalDetectorMessenger( EMCalDetectorConstruction *detector ) : fDetector( detec
   fUpdateCmd = new G4UIcmdWithoutParameter( "/EMCal/detector/update", this );
   fUpdateCmd -> SetGuidance( "Update geometry" );
   fUpdateCmd -> SetGuidance( "This command MUST be applied before \"beamOn\"" );
+  fUpdateCmd -> SetGuidance( "The geometry is built again at the beginning of the next run" );
+  fUpdateCmd -> SetToBeBroadcasted( false );
   fUpdateCmd -> AvailableForStates( G4State_Idle );
 
   // To change the world parameters
@@ -181,7 +244,10 @@ EMCalDetectorMessenger::~EMCalDetectorMessenger() {
   delete fDetDir;
   delete fDetectorColourCmd;
   delete fDetectorMaterialCmd;
+  delete fBirksConstantCmd;
   delete fDistanceCmd;
+  delete fEnvelopeMarginCmd;
+  delete fKillEscapingCmd;
   delete fModuleHalfLengthXcmd;
   delete fModuleHalfLengthYcmd;
   delete fModuleHalfLengthZcmd;
@@ -189,7 +255,11 @@ EMCalDetectorMessenger::~EMCalDetectorMessenger() {
   delete fNxModulesCmd;
   delete fNyModulesCmd;
   delete fNzModulesCmd;
+  delete fNxSubCellsCmd;
+  delete fNySubCellsCmd;
+  delete fNzSubCellsCmd;
   delete fPrintCmd;
+  delete fScoringModeCmd;
   delete fSGVolumeCmd;
   delete fSGVolumeColourCmd;
   delete fSGVolumeMaterialCmd;
@@ -205,12 +275,19 @@ EMCalDetectorMessenger::~EMCalDetectorMessenger() {
 void EMCalDetectorMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
 
   // Detector parameters
-  if      ( command == fDetectorColourCmd )
+  if      ( command == fBirksConstantCmd )
+    fDetector ->
+      SetBirksConstant( fBirksConstantCmd -> GetNewDoubleValue( value )*mm/MeV );
+  else if ( command == fDetectorColourCmd )
     fDetector -> SetDetectorColour( value );
   else if ( command == fDetectorMaterialCmd )
     fDetector -> SetDetectorMaterial( value );
   else if ( command == fDistanceCmd )
     fDetector -> SetDistance( fDistanceCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fEnvelopeMarginCmd )
+    fDetector -> SetEnvelopeMargin( fEnvelopeMarginCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fKillEscapingCmd )
+    fDetector -> SetKillEscaping( fKillEscapingCmd -> GetNewBoolValue( value ) );
 
   // Module parameters
   else if ( command == fModuleHalfLengthXcmd )
@@ -234,11 +311,24 @@ void EMCalDetectorMessenger::SetNewValue( G4UIcommand *command, G4String value )
   else if ( command == fNzModulesCmd )
     fDetector ->
       SetNzModules( fNzModulesCmd -> GetNewIntValue( value ) );
+  else if ( command == fNxSubCellsCmd )
+    fDetector ->
+      SetNxSubCells( fNxSubCellsCmd -> GetNewIntValue( value ) );
+  else if ( command == fNySubCellsCmd )
+    fDetector ->
+      SetNySubCells( fNySubCellsCmd -> GetNewIntValue( value ) );
+  else if ( command == fNzSubCellsCmd )
+    fDetector ->
+      SetNzSubCells( fNzSubCellsCmd -> GetNewIntValue( value ) );
 
   // To print the detector parameters
   else if ( command == fPrintCmd )
     fDetector -> PrintParameters();
 
+  // Scoring mode
+  else if ( command == fScoringModeCmd )
+    fDetector -> SetScoringMode( value );
+
   // SGV parameters
   else if ( command == fSGVolumeCmd )
     fDetector -> SetSGVolume( fSGVolumeCmd -> GetNewBoolValue( value ) );
@@ -20,20 +20,56 @@
 
 #include "EMCalEventAction.hh"
 #include "EMCalEventActionMessenger.hh"
+#include "EMCalDetectorConstruction.hh"
+#include "EMCalHit.hh"
+#include "EMCalProgressMeter.hh"
 #include "EMCalRun.hh"
+#include "EMCalRunAction.hh"
+#include "EMCalSubEvent.hh"
+#include "EMCalSubEventScheduler.hh"
 
 #include "G4Event.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
 #include "G4RunManager.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 
+#include <ctime>
 #include <iomanip>
 
 
+//_______________________________________________________________________________
+// Returns the CPU time used by the current thread, in seconds
+static inline G4double ThreadCpuTime() {
+
+  timespec ts;
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+
 //_______________________________________________________________________________
 // Constructor
 EMCalEventAction::EMCalEventAction() :
-  G4UserEventAction(), fPrintModule( 1 ) {
+  G4UserEventAction(),
+  fHitsCollectionID( -1 ),
+  fRun( 0 ),
+  fNsteps( 0 ),
+  fCpuStart( 0 ),
+  fSlowFactor( 0 ),
+  fSlowTime( 0 ) {
 
   fMessenger = new EMCalEventActionMessenger( this );
+
+  fDetector = static_cast<const EMCalDetectorConstruction*>
+    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+
+  // The scheduler of the sub-events only exists in multithreaded mode
+  fScheduler = EMCalSubEventScheduler::GetInstance();
 } 
 
 //_______________________________________________________________________________
@@ -42,33 +78,126 @@ EMCalEventAction::~EMCalEventAction() { delete fMessenger; }
 
 //_______________________________________________________________________________
 // All the functions that are called each time an event starts
-void EMCalEventAction::BeginOfEventAction( const G4Event* ) {
+void EMCalEventAction::BeginOfEventAction( const G4Event *event ) {
+
+  // Caches the current run, so the stepping action does not need to ask the run
+  // manager for it at each step, and restarts the values of the energy for all the
+  // modules
+  fRun = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> 
+				 GetNonConstCurrentRun() );
+  fRun -> Reset();
+
+  // The shower profiles are filled with respect to the axis of the primary particle.
+  // For the sub-events it is that of the event which created them.
+  const EMCalSubEvent *subEvent = EMCalSubEvent::GetCurrent();
+  if ( fRun -> FillingProfiles() && subEvent )
+    fRun -> SetPrimaryAxis( subEvent -> GetPrimaryOrigin(), subEvent -> GetPrimaryDirection() );
+  else if ( fRun -> FillingProfiles() ) {
+    const G4PrimaryVertex *vertex = event -> GetPrimaryVertex();
+    fRun -> SetPrimaryAxis( vertex -> GetPosition(),
+			    vertex -> GetPrimary() -> GetMomentumDirection() );
+  }
 
-  // Restarts the values of the energy for all the modules
-  EMCalRun *run 
-    = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> 
-			      GetNonConstCurrentRun() );
-  run -> Reset();
+  fCpuStart  = ThreadCpuTime();
+  fWallStart = std::chrono::steady_clock::now();
 }
 
 //_______________________________________________________________________________
 // All the functions that are called each time an event ends
 void EMCalEventAction::EndOfEventAction( const G4Event *event ) {
 
-  // Gets the current run
-  EMCalRun *run 
-    = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> 
-			      GetNonConstCurrentRun() );
+  // The events and steps are added to the counters of the progress meter, which may
+  // print the progress of the whole run. The sub-events only add their steps, since
+  // they belong to the event which created them. In sequential mode the meter is
+  // created after the event action, so it is not cached.
+  EMCalProgressMeter *meter = EMCalProgressMeter::GetInstance();
+  if ( meter )
+    meter -> AddEvent( EMCalSubEvent::GetCurrent() ? 0 : 1, fNsteps );
+  fNsteps = 0;
+
+  // If the energy is scored by the sensitive detectors, the hits are added to the run
+  if ( fDetector -> GetScoringMode() == EMCalDetectorConstruction::kSensitiveDetector )
+    this -> TransferHits( event );
+
+  // The energy deposited by a sub-event is given back to the thread which created it,
+  // together with the CPU time taken to process it
+  EMCalSubEvent *subEvent = EMCalSubEvent::GetCurrent();
+  if ( subEvent ) {
+    fRun -> ExportSubEvent( subEvent );
+    subEvent -> SetCpuTime( ThreadCpuTime() - fCpuStart );
+    fScheduler -> Complete( subEvent );
+    return;
+  }
+
+  // Adds the energy deposited by the sub-events sent to other threads, once all of
+  // them have been processed. The times of the event are taken afterwards, so they
+  // include those of its sub-events: the wall time until the last of them finishes,
+  // and the CPU time of all the threads which processed them.
+  G4double cpu = 0;
+  if ( fScheduler ) {
+    std::vector<EMCalSubEvent*> subEvents = fScheduler -> Collect( G4Threading::G4GetThreadId() );
+    for ( size_t isub = 0; isub < subEvents.size(); isub++ ) {
+      fRun -> MergeSubEvent( subEvents[ isub ] );
+      cpu += subEvents[ isub ] -> GetCpuTime();
+      delete subEvents[ isub ];
+    }
+  }
+
+  G4double wall = std::chrono::duration<G4double>
+    ( std::chrono::steady_clock::now() - fWallStart ).count();
+  cpu += ThreadCpuTime() - fCpuStart;
+
+  // Gets the number of the event and passes it to the EMCalRun class. It is counted
+  // from the first event of the run.
+  G4int evtNb = EMCalRunAction::GetEventNumber( event -> GetEventID() );
+  fRun -> Fill( evtNb );
+
+  // The events taking more time than the thresholds are saved with the primary
+  // particle, so they can be simulated again. The median is that of the previous
+  // events of the run, which do not include this one.
+  G4double median = fRun -> GetMedianEventTime();
+  if ( ( fSlowTime > 0 && wall*s > fSlowTime ) ||
+       ( fSlowFactor > 0 && median > 0 && wall > fSlowFactor*median ) ) {
+
+    const G4PrimaryParticle *primary = event -> GetPrimaryVertex() -> GetPrimary();
+
+    EMCalRun::SlowEvent slow;
+    slow.Number    = evtNb;
+    slow.WallTime  = wall;
+    slow.CpuTime   = cpu;
+    slow.Energy    = primary -> GetKineticEnergy();
+    slow.Direction = primary -> GetMomentumDirection();
+    fRun -> AddSlowEvent( slow );
+
+    G4cout << " Slow event " << evtNb << ":\t" << wall << " s ( CPU " << cpu
+	   << " s, median " << median << " s )" << G4endl;
+  }
+  fRun -> AddEventTime( wall, cpu );
+}
+
+//_______________________________________________________________________________
+// Adds the energy of the hits created by the sensitive detector to the run
+void EMCalEventAction::TransferHits( const G4Event *event ) {
+
+  if ( fHitsCollectionID < 0 )
+    fHitsCollectionID = G4SDManager::GetSDMpointer() ->
+      GetCollectionID( "EMCalSD/EMCalHitsCollection" );
+
+  G4HCofThisEvent *hce = event -> GetHCofThisEvent();
+  if ( !hce || fHitsCollectionID < 0 )
+    return;
 
-  // Gets the number of the event and passes it to the EMCalRun class
-  G4int evtNb = event -> GetEventID();
-  run -> Fill( evtNb );
+  EMCalHitsCollection *hc =
+    static_cast<EMCalHitsCollection*>( hce -> GetHC( fHitsCollectionID ) );
+  if ( !hc )
+    return;
 
-  if ( evtNb % fPrintModule == 0 ) {
+  for ( size_t ihit = 0; ihit < hc -> entries(); ihit++ ) {
 
-    G4cout << " ================================================="   << G4endl;
-    G4cout << " Events processed: " << evtNb << G4endl;
-    CLHEP::HepRandom::showEngineStatus();
-    G4cout << " =================================================\n" << G4endl;
+    const EMCalHit *hit = ( *hc )[ ihit ];
+    if ( hit -> GetType() == EMCalDetectorConstruction::kDetector )
+      fRun -> AddEnergyToDetector( hit -> GetEnergy(), hit -> GetModule(), hit -> GetNsteps() );
+    else
+      fRun -> AddEnergyToSGVolume( hit -> GetEnergy(), hit -> GetModule(), hit -> GetNsteps() );
   }
 }
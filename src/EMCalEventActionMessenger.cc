@@ -28,12 +28,24 @@ EMCalEventActionMessenger::EMCalEventActionMessenger( EMCalEventAction *eventAct
     = new G4UIdirectory( "/EMCal/event/" );
   fEventDir -> SetGuidance( "Event control" );
 
-  fPrintModuleCmd
-    = new G4UIcmdWithAnInteger( "/EMCal/event/setPrintModule", this );
-  fPrintModuleCmd
-    -> SetGuidance( "Select the number of events to be reached for printing" );
-  fPrintModuleCmd -> SetParameterName( "PrintModule", false );
-  fPrintModuleCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+  fSlowFactorCmd
+    = new G4UIcmdWithADouble( "/EMCal/event/setSlowFactor", this );
+  fSlowFactorCmd
+    -> SetGuidance( "Save the events taking more than this factor times the median time" );
+  fSlowFactorCmd -> SetGuidance( "of the run to the slow event file. If zero it is not applied." );
+  fSlowFactorCmd -> SetParameterName( "SlowFactor", false );
+  fSlowFactorCmd -> SetRange( "SlowFactor >= 0" );
+  fSlowFactorCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSlowTimeCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/event/setSlowTime", this );
+  fSlowTimeCmd
+    -> SetGuidance( "Save the events taking more than this time to the slow event file." );
+  fSlowTimeCmd -> SetGuidance( "If zero it is not applied." );
+  fSlowTimeCmd -> SetParameterName( "SlowTime", false );
+  fSlowTimeCmd -> SetRange( "SlowTime >= 0" );
+  fSlowTimeCmd -> SetUnitCategory( "Time" );
+  fSlowTimeCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
 
 }
 
@@ -42,13 +54,16 @@ EMCalEventActionMessenger::EMCalEventActionMessenger( EMCalEventAction *eventAct
 EMCalEventActionMessenger::~EMCalEventActionMessenger() {
 
   delete fEventDir;
-  delete fPrintModuleCmd;
+  delete fSlowFactorCmd;
+  delete fSlowTimeCmd;
 }
 
 //_______________________________________________________________________________
 // Modifies one attribute of the EventAction class
 void EMCalEventActionMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
 
-  if ( command == fPrintModuleCmd )
-    fEventAction -> SetPrintModule( fPrintModuleCmd -> GetNewIntValue( value ) );
+  if      ( command == fSlowFactorCmd )
+    fEventAction -> SetSlowFactor( fSlowFactorCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSlowTimeCmd )
+    fEventAction -> SetSlowTime( fSlowTimeCmd -> GetNewDoubleValue( value ) );
 }
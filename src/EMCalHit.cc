@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Hit class used by the sensitive detector. Each hit contains the  //
+//  energy deposited in one volume ( detector or shower-generator volume ) of a  //
+//  module during an event.                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalHit.hh"
+
+
+//_______________________________________________________________________________
+// Allocator of the hits ( one per thread )
+G4ThreadLocal G4Allocator<EMCalHit> *EMCalHitAllocator = 0;
+
+//_______________________________________________________________________________
+// Constructor
+EMCalHit::EMCalHit( G4int module, EMCalDetectorConstruction::VolumeType type ) :
+  G4VHit(),
+  fEnergy( 0 ),
+  fModule( module ),
+  fNsteps( 0 ),
+  fType( type ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalHit::~EMCalHit() { }
@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the MTRunManager class. It is the multithreaded run manager of       //
+//  Geant4, where the number of events given to a worker each time it asks for   //
+//  more is computed from the measured time per event. The chunks take a fixed   //
+//  time, so the workers do not ask the master too often, but never more than a  //
+//  fraction of the remaining events, so they get smaller at the end of the run  //
+//  and the workers finish at the same time. The number of events, of chunks and //
+//  the time of each worker are reported at the end of the run.                  //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#include "EMCalMTRunManager.hh"
+#include "EMCalMTRunManagerMessenger.hh"
+#include "EMCalWorkerThreadInitialization.hh"
+
+#include "G4AutoLock.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <iomanip>
+
+
+//_______________________________________________________________________________
+// Constructor. The workers use their own run manager, which also processes the
+// sub-events of the other workers.
+EMCalMTRunManager::EMCalMTRunManager() :
+  G4MTRunManager(),
+  fChunkTime( 0 ),
+  fEventTime( 0 ) {
+
+  fScheduler = new EMCalSubEventScheduler;
+  fMessenger = new EMCalMTRunManagerMessenger( this );
+
+  this -> SetUserInitialization( new EMCalWorkerThreadInitialization );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalMTRunManager::~EMCalMTRunManager() {
+
+  delete fMessenger;
+  delete fScheduler;
+}
+
+//_______________________________________________________________________________
+// Initializes the event loop, resetting the statistics of the workers and the
+// queue of sub-events. The time per event measured in the previous runs is kept.
+void EMCalMTRunManager::InitializeEventLoop( G4int n_event, const char *macroFile, G4int n_select ) {
+
+  size_t nthreads = this -> GetNumberOfThreads();
+
+  fWorkerChunks.assign( nthreads, 0 );
+  fWorkerEvents.assign( nthreads, 0 );
+  fWorkerEnd.assign( nthreads, Clock::time_point() );
+  fWorkerLastChunk.assign( nthreads, 0 );
+  fWorkerLastRequest.assign( nthreads, Clock::time_point() );
+
+  fStart = Clock::now();
+
+  fScheduler -> StartRun( nthreads );
+
+  G4MTRunManager::InitializeEventLoop( n_event, macroFile, n_select );
+}
+
+//_______________________________________________________________________________
+// Prints the number of events and of chunks processed by each worker, and the time
+// the workers were idle at the end of the run
+void EMCalMTRunManager::PrintStatistics() const {
+
+  if ( fWorkerEvents.empty() )
+    return;
+
+  Clock::time_point last = *std::max_element( fWorkerEnd.begin(), fWorkerEnd.end() );
+
+  G4double total = std::chrono::duration<G4double>( last - fStart ).count();
+  G4double idle  = 0;
+  G4int    sum   = 0;
+  G4int    max   = 0;
+
+  G4cout << "  Worker   Events   Chunks   Time [s]" << G4endl;
+  for ( size_t iw = 0; iw < fWorkerEvents.size(); iw++ ) {
+
+    G4double busy = std::chrono::duration<G4double>( fWorkerEnd[ iw ] - fStart ).count();
+
+    G4cout << "  " << std::setw( 6 ) << iw
+	   << "   " << std::setw( 6 ) << fWorkerEvents[ iw ]
+	   << "   " << std::setw( 6 ) << fWorkerChunks[ iw ]
+	   << "   " << std::setw( 8 ) << busy << G4endl;
+
+    idle += total - busy;
+    sum  += fWorkerEvents[ iw ];
+    max   = std::max( max, fWorkerEvents[ iw ] );
+  }
+
+  if ( total > 0 )
+    G4cout << "  Idle time at the end of the run:\t" << idle << " s ( "
+	   << 100.*idle/( total*fWorkerEvents.size() ) << " % )" << G4endl;
+  if ( sum > 0 )
+    G4cout << "  Maximum over mean events:       \t"
+	   << G4double( max )*fWorkerEvents.size()/sum << G4endl;
+
+  fScheduler -> PrintStatistics();
+}
+
+//_______________________________________________________________________________
+// Gives the next chunk of events to the worker calling this method. The time per
+// event is measured from the time the worker took to process its previous chunk.
+G4int EMCalMTRunManager::SetUpNEvents( G4Event      *evt,
+				       G4SeedsQueue *seedsQueue,
+				       G4bool        reseedRequired ) {
+
+  G4AutoLock lock( &fMutex );
+
+  G4int             id  = G4Threading::G4GetThreadId();
+  Clock::time_point now = Clock::now();
+
+  // The mean time per event is updated giving a larger weight to the last chunks
+  if ( fWorkerLastChunk[ id ] > 0 ) {
+
+    G4double time = std::chrono::duration<G4double>
+      ( now - fWorkerLastRequest[ id ] ).count()/fWorkerLastChunk[ id ];
+
+    fEventTime = fEventTime > 0 ? 0.8*fEventTime + 0.2*time : time;
+  }
+
+  // The chunks take the given time, but at most a half of the remaining events are
+  // shared among the workers. Until the time per event is measured the workers
+  // get single events.
+  if ( fChunkTime > 0 ) {
+
+    G4int remaining = numberOfEventToBeProcessed - numberOfEventProcessed;
+    G4int chunk     = fEventTime > 0 ? G4int( fChunkTime/s/fEventTime ) : 1;
+
+    eventModulo = std::max( 1, std::min( chunk, remaining/( 2*this -> GetNumberOfThreads() ) ) );
+  }
+
+  G4int nev = G4MTRunManager::SetUpNEvents( evt, seedsQueue, reseedRequired );
+
+  fWorkerLastChunk[ id ]   = nev;
+  fWorkerLastRequest[ id ] = now;
+  if ( nev > 0 ) {
+    fWorkerChunks[ id ]++;
+    fWorkerEvents[ id ] += nev;
+  }
+  else
+    fWorkerEnd[ id ] = now;
+
+  return nev;
+}
+
+#endif
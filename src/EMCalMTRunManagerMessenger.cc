@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the MTRunManager class, to set the time of the      //
+//  chunks of events given to the workers.                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#include "EMCalMTRunManagerMessenger.hh"
+
+//_______________________________________________________________________________
+// Constructor. The commands only concern the master, so they are not broadcast to
+// the workers.
+EMCalMTRunManagerMessenger::EMCalMTRunManagerMessenger( EMCalMTRunManager *runManager ) :
+  fRunManager( runManager ) {
+
+  fDispatchDir = new G4UIdirectory( "/EMCal/dispatch/", false );
+  fDispatchDir -> SetGuidance( "Control of the events given to the worker threads" );
+
+  fChunkTimeCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/dispatch/setChunkTime", this );
+  fChunkTimeCmd -> SetGuidance( "Time the chunks of events given to the workers should take." );
+  fChunkTimeCmd -> SetGuidance( "The size is computed from the measured time per event. If" );
+  fChunkTimeCmd -> SetGuidance( "zero the chunks have the size given by /run/eventModulo." );
+  fChunkTimeCmd -> SetParameterName( "ChunkTime", false );
+  fChunkTimeCmd -> SetRange( "ChunkTime >= 0" );
+  fChunkTimeCmd -> SetUnitCategory( "Time" );
+  fChunkTimeCmd -> SetDefaultUnit( "ms" );
+  fChunkTimeCmd -> SetToBeBroadcasted( false );
+  fChunkTimeCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSubEventMinEnergyCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/dispatch/setSubEventMinEnergy", this );
+  fSubEventMinEnergyCmd -> SetGuidance( "Minimum kinetic energy of the secondary tracks sent to the" );
+  fSubEventMinEnergyCmd -> SetGuidance( "workers without events, so the tracks of an event are shared" );
+  fSubEventMinEnergyCmd -> SetGuidance( "among them. If zero the events are not divided. Not used if" );
+  fSubEventMinEnergyCmd -> SetGuidance( "the pulses, the sub-cells or the steps are written." );
+  fSubEventMinEnergyCmd -> SetParameterName( "SubEventMinEnergy", false );
+  fSubEventMinEnergyCmd -> SetRange( "SubEventMinEnergy >= 0" );
+  fSubEventMinEnergyCmd -> SetUnitCategory( "Energy" );
+  fSubEventMinEnergyCmd -> SetDefaultUnit( "MeV" );
+  fSubEventMinEnergyCmd -> SetToBeBroadcasted( false );
+  fSubEventMinEnergyCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSubEventEnergyCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/dispatch/setSubEventEnergy", this );
+  fSubEventEnergyCmd -> SetGuidance( "Energy of the tracks grouped in each sub-event" );
+  fSubEventEnergyCmd -> SetParameterName( "SubEventEnergy", false );
+  fSubEventEnergyCmd -> SetRange( "SubEventEnergy > 0" );
+  fSubEventEnergyCmd -> SetUnitCategory( "Energy" );
+  fSubEventEnergyCmd -> SetDefaultUnit( "GeV" );
+  fSubEventEnergyCmd -> SetToBeBroadcasted( false );
+  fSubEventEnergyCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalMTRunManagerMessenger::~EMCalMTRunManagerMessenger() {
+
+  delete fDispatchDir;
+  delete fChunkTimeCmd;
+  delete fSubEventMinEnergyCmd;
+  delete fSubEventEnergyCmd;
+}
+
+//_______________________________________________________________________________
+// Modifies one attribute of the MTRunManager class
+void EMCalMTRunManagerMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
+
+  if ( command == fChunkTimeCmd )
+    fRunManager -> SetChunkTime( fChunkTimeCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSubEventMinEnergyCmd )
+    fRunManager -> GetSubEventScheduler() ->
+      SetMinEnergy( fSubEventMinEnergyCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSubEventEnergyCmd )
+    fRunManager -> GetSubEventScheduler() ->
+      SetSubEventEnergy( fSubEventEnergyCmd -> GetNewDoubleValue( value ) );
+}
+
+#endif
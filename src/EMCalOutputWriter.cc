@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the OutputWriter class. It fills the output tree in a separate       //
+//  thread, so the compression and the writing of the baskets do not stop the    //
+//  simulation. The variables of each branch are bound to a copy owned by the    //
+//  writer. At the end of each event the variables are copied into a record of a //
+//  bounded queue with a single producer and a single consumer, without locks,   //
+//  and the writer thread copies them back and fills the tree. If the queue is   //
+//  full the simulation waits for the writer.                                    //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalOutputWriter.hh"
+
+#include "G4Exception.hh"
+
+#include "TFile.h"
+
+#include <chrono>
+#include <cstring>
+
+
+//_______________________________________________________________________________
+// Returns < n > rounded up to a multiple of the size of a double, so the variables
+// in the records are aligned
+static inline size_t Align( size_t n ) {
+  return ( n + sizeof( G4double ) - 1 )/sizeof( G4double )*sizeof( G4double );
+}
+
+//_______________________________________________________________________________
+// Constructor. The capacity of the queue is given in number of events.
+EMCalOutputWriter::EMCalOutputWriter( size_t capacity ) :
+  fCapacity( capacity ),
+  fFlushEntries( 0 ),
+  fFlushFile( false ),
+  fRecordSize( 0 ),
+  fRecords( 0 ),
+  fTree( 0 ),
+  fHead( 0 ),
+  fTail( 0 ),
+  fStop( false ),
+  fNrecords( 0 ),
+  fNfull( 0 ),
+  fMaxDepth( 0 ),
+  fSumDepth( 0 ),
+  fWaitTime( 0 ) { }
+
+//_______________________________________________________________________________
+// Destructor. The writer thread is stopped if it is running.
+EMCalOutputWriter::~EMCalOutputWriter() {
+
+  this -> Stop();
+
+  for ( size_t ib = 0; ib < fBlocks.size(); ib++ )
+    delete[] fBlocks[ ib ].Copy;
+
+  delete[] fRecords;
+}
+
+//_______________________________________________________________________________
+// Binds the variable at < source >, an array of < n > elements of < size > bytes,
+// and returns the address of the copy to be given to the branch. If < count > is
+// given, it is the number of elements used in each event, which must have been
+// bound before.
+void* EMCalOutputWriter::Bind( void *source, size_t size, size_t n, const G4int *count ) {
+
+  Block block;
+  block.Source      = static_cast<const char*>( source );
+  block.Copy        = new char[ size*n ];
+  block.Size        = size;
+  block.Offset      = fRecordSize;
+  block.SourceCount = count;
+  block.CopyCount   = 0;
+
+  if ( count ) {
+    for ( size_t ib = 0; ib < fBlocks.size(); ib++ )
+      if ( fBlocks[ ib ].Source == reinterpret_cast<const char*>( count ) )
+	block.CopyCount = reinterpret_cast<const G4int*>( fBlocks[ ib ].Copy );
+    if ( !block.CopyCount )
+      G4Exception( "EMCalOutputWriter::Bind", "EMCal", FatalException,
+		   "The counter of an array must be bound before the array" );
+  }
+
+  std::memcpy( block.Copy, source, size*n );
+
+  fRecordSize += Align( size*n );
+  fBlocks.push_back( block );
+
+  return block.Copy;
+}
+
+//_______________________________________________________________________________
+// Prints the statistics of the queue. The back-pressure is given by the number of
+// events which found the queue full and the time the simulation waited.
+void EMCalOutputWriter::PrintStatistics() const {
+
+  if ( fNrecords == 0 )
+    return;
+
+  G4cout << "  Writer queue:      \t" << fNrecords << " records, capacity "
+	 << fCapacity << G4endl;
+  G4cout << "  Queue depth:       \t" << fSumDepth/fNrecords << " ( mean ), "
+	 << fMaxDepth << " ( max )" << G4endl;
+  G4cout << "  Queue full:        \t" << fNfull << " times, "
+	 << fWaitTime << " s waiting" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Copies the bound variables of the current event into the next record of the
+// queue. If the queue is full it waits until the writer reads a record.
+void EMCalOutputWriter::Push() {
+
+  size_t head  = fHead.load( std::memory_order_relaxed );
+  size_t depth = head - fTail.load( std::memory_order_acquire );
+
+  if ( depth == fCapacity ) {
+
+    fNfull++;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while ( head - fTail.load( std::memory_order_acquire ) == fCapacity )
+      std::this_thread::yield();
+    fWaitTime += std::chrono::duration<G4double>
+      ( std::chrono::steady_clock::now() - start ).count();
+  }
+
+  char *record = fRecords + ( head % fCapacity )*fRecordSize;
+  for ( size_t ib = 0; ib < fBlocks.size(); ib++ ) {
+    const Block &block = fBlocks[ ib ];
+    size_t n = block.SourceCount ? *block.SourceCount : 1;
+    std::memcpy( record + block.Offset, block.Source, n*block.Size );
+  }
+
+  fHead.store( head + 1, std::memory_order_release );
+
+  fNrecords++;
+  fSumDepth += depth;
+  if ( depth > fMaxDepth )
+    fMaxDepth = depth;
+}
+
+//_______________________________________________________________________________
+// Reads the records of the queue and fills the tree with them, until the writer
+// is stopped and the queue is empty
+void EMCalOutputWriter::Run() {
+
+  size_t tail = fTail.load( std::memory_order_relaxed );
+
+  while ( true ) {
+
+    if ( tail == fHead.load( std::memory_order_acquire ) ) {
+
+      // The position of the producer is read again after the stop flag, so the
+      // records pushed before stopping are always read
+      if ( fStop.load( std::memory_order_acquire ) &&
+	   tail == fHead.load( std::memory_order_acquire ) )
+	break;
+
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      continue;
+    }
+
+    const char *record = fRecords + ( tail % fCapacity )*fRecordSize;
+    for ( size_t ib = 0; ib < fBlocks.size(); ib++ ) {
+      const Block &block = fBlocks[ ib ];
+      size_t n = block.CopyCount ? *block.CopyCount : 1;
+      std::memcpy( block.Copy, record + block.Offset, n*block.Size );
+    }
+
+    fTail.store( ++tail, std::memory_order_release );
+
+    fTree -> Fill();
+
+    // Saves the tree each certain number of entries. If the file is buffered, it is
+    // written, sending the entries to be merged in the output file.
+    if ( fFlushEntries > 0 && fTree -> GetEntries() % fFlushEntries == 0 ) {
+      if ( fFlushFile )
+	fTree -> GetCurrentFile() -> Write();
+      else
+	fTree -> AutoSave();
+    }
+  }
+}
+
+//_______________________________________________________________________________
+// Allocates the queue and starts the writer thread, which fills < tree >. All the
+// variables must have been bound at this point.
+void EMCalOutputWriter::Start( TTree *tree, G4int flushEntries, G4bool flushFile ) {
+
+  fTree         = tree;
+  fFlushEntries = flushEntries;
+  fFlushFile    = flushFile;
+
+  delete[] fRecords;
+  fRecords = new char[ fCapacity*fRecordSize ];
+
+  fHead.store( 0 );
+  fTail.store( 0 );
+  fStop.store( false );
+
+  fThread = std::thread( &EMCalOutputWriter::Run, this );
+}
+
+//_______________________________________________________________________________
+// Waits until the writer thread has filled the tree with all the records of the
+// queue and stops it
+void EMCalOutputWriter::Stop() {
+
+  if ( !fThread.joinable() )
+    return;
+
+  fStop.store( true, std::memory_order_release );
+  fThread.join();
+}
@@ -20,6 +20,7 @@
 
 #include "EMCalPrimaryGeneratorAction.hh"
 #include "EMCalPrimaryGeneratorActionMessenger.hh"
+#include "EMCalRunAction.hh"
 
 #include "G4LogicalVolumeStore.hh"
 #include "G4LogicalVolume.hh"
@@ -31,8 +32,19 @@
 #include "Randomize.hh"
 
 #include <cmath>
+#include <cstdint>
 
 
+//_______________________________________________________________________________
+// Mixes the bits of < x > ( SplitMix64 finalizer ), so close inputs give unrelated
+// outputs
+static inline std::uint64_t Mix( std::uint64_t x ) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x  = ( x ^ ( x >> 30 ) )*0xbf58476d1ce4e5b9ULL;
+  x  = ( x ^ ( x >> 27 ) )*0x94d049bb133111ebULL;
+  return x ^ ( x >> 31 );
+}
+
 //_______________________________________________________________________________
 // Constructor
 EMCalPrimaryGeneratorAction::EMCalPrimaryGeneratorAction() :
@@ -63,9 +75,48 @@ EMCalPrimaryGeneratorAction::EMCalPrimaryGeneratorAction() :
 // Destructor
 EMCalPrimaryGeneratorAction::~EMCalPrimaryGeneratorAction() { delete fParticleGun; }
 
+//_______________________________________________________________________________
+// Computes the two seeds of the event with number < evtNb > from the seed of the
+// run. If < subEvent > is not negative, they are those of the sub-event with that
+// index created by the event. They are kept in the ranges accepted by the Ranecu
+// engine.
+void EMCalPrimaryGeneratorAction::GetEventSeeds( G4long runSeed,
+						 G4int  evtNb,
+						 long  *seeds,
+						 G4int  subEvent ) {
+
+  std::uint64_t key = Mix( Mix( std::uint64_t( runSeed ) ) + std::uint64_t( evtNb ) );
+  if ( subEvent >= 0 )
+    key = Mix( key + std::uint64_t( subEvent ) );
+
+  seeds[ 0 ] = 1 + long( ( key & 0xffffffffULL ) % 2147483562ULL );
+  seeds[ 1 ] = 1 + long( ( key >> 32 ) % 2147483398ULL );
+}
+
+//_______________________________________________________________________________
+// Seeds the random engine of this thread from the seed of the run and the number
+// of the event, and the index of the sub-event if it is not negative. The gaussian
+// generator keeps the second number of each pair it computes, which would come
+// from the previous event of the thread, so it is discarded.
+void EMCalPrimaryGeneratorAction::SeedEvent( G4long runSeed, G4int evtNb, G4int subEvent ) {
+
+  long seeds[ 3 ];
+  GetEventSeeds( runSeed, evtNb, seeds, subEvent );
+  seeds[ 2 ] = 0;
+
+  G4Random::setTheSeeds( seeds );
+  CLHEP::RandGauss::setFlag( false );
+}
+
 //_______________________________________________________________________________
 // This method sets the direction, energy and type for the incident particle
 void EMCalPrimaryGeneratorAction::GeneratePrimaries( G4Event *event ) {
+
+  // The random numbers of each event only depend on the seed of the run and on the
+  // number of the event, so any event can be simulated again with any number of
+  // threads
+  SeedEvent( EMCalRunAction::GetRunSeed(),
+	     EMCalRunAction::GetEventNumber( event -> GetEventID() ) );
   
   // Sets the particle energy
   fParticleGun -> SetParticleEnergy( fEmissionEnergy -> GetRandom() );
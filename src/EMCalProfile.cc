@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Profile class. It is a histogram with fixed bins, used to        //
+//  accumulate the energy deposited in the calorimeter versus the depth and the  //
+//  distance to the axis of the primary particle during the run. Each thread     //
+//  fills its own profiles, which are added at the end of the run and converted  //
+//  to ROOT histograms.                                                          //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalProfile.hh"
+
+#include <cmath>
+
+
+//_______________________________________________________________________________
+// Constructor. The profile has no bins until it is configured.
+EMCalProfile::EMCalProfile() :
+  fInvWidth( 0 ), fMax( 0 ), fMin( 0 ), fNbins( 0 ), fSumW( 2, 0. ), fSumW2( 2, 0. ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalProfile::~EMCalProfile() { }
+
+//_______________________________________________________________________________
+// Adds the contents of another profile with the same binning
+void EMCalProfile::Add( const EMCalProfile &other ) {
+
+  if ( other.fNbins != fNbins || other.fMin != fMin || other.fMax != fMax ) {
+    G4cout << "WARNING: Profiles with different binning can not be added" << G4endl;
+    return;
+  }
+
+  for ( size_t ibin = 0; ibin < fSumW.size(); ibin++ ) {
+    fSumW[ ibin ]  += other.fSumW[ ibin ];
+    fSumW2[ ibin ] += other.fSumW2[ ibin ];
+  }
+}
+
+//_______________________________________________________________________________
+// Sets the binning of the profile. The contents are set to zero.
+void EMCalProfile::Configure( G4int nbins, G4double min, G4double max ) {
+
+  fNbins    = nbins;
+  fMin      = min;
+  fMax      = max;
+  fInvWidth = nbins/( max - min );
+
+  fSumW.assign( nbins + 2, 0. );
+  fSumW2.assign( nbins + 2, 0. );
+}
+
+//_______________________________________________________________________________
+// Creates a ROOT histogram with the contents of the profile. The histogram is
+// owned by the current directory.
+TH1D* EMCalProfile::MakeHistogram( const char *name, const char *title ) const {
+
+  TH1D *hist = new TH1D( name, title, fNbins, fMin, fMax );
+
+  for ( G4int ibin = 0; ibin < fNbins + 2; ibin++ ) {
+    hist -> SetBinContent( ibin, fSumW[ ibin ] );
+    hist -> SetBinError( ibin, std::sqrt( fSumW2[ ibin ] ) );
+  }
+
+  return hist;
+}
@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the ProgressMeter class. It reports the progress of the run, the     //
+//  number of events and steps processed per second and the estimated time to    //
+//  finish it, as well as the rates of each thread. The threads add their events //
+//  and steps to their own counters, and the first thread finding that the       //
+//  interval since the last report has passed prints the next one, so a single   //
+//  report is printed for the whole run.                                         //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalProgressMeter.hh"
+
+#include "G4Exception.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+
+//_______________________________________________________________________________
+// Meter shared by all the threads
+EMCalProgressMeter *EMCalProgressMeter::fInstance = 0;
+
+//_______________________________________________________________________________
+// Constructor. The progress is reported every ten seconds by default.
+EMCalProgressMeter::EMCalProgressMeter() :
+  fCounters( 0 ),
+  fInterval( 10*s ),
+  fNevents( 0 ),
+  fNthreads( 0 ),
+  fStartTime( std::chrono::steady_clock::now() ),
+  fNextReport( 0 ),
+  fLastReport( 0 ),
+  fLastEvents( 0 ) {
+
+  fInstance = this;
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalProgressMeter::~EMCalProgressMeter() {
+
+  std::free( fCounters );
+  delete[] fLastEvents;
+
+  if ( fInstance == this )
+    fInstance = 0;
+}
+
+//_______________________________________________________________________________
+// Adds the events and steps processed by the current thread. It is called at the
+// end of each event, so only an addition to the counter of the thread and a reading
+// of the clock are done, unless the time of the next report has been reached. The
+// thread which first sees it prints the report, and the others go on.
+void EMCalProgressMeter::AddEvent( G4int nevents, G4long nsteps ) {
+
+  G4int id = G4Threading::G4GetThreadId();
+  Counter &counter = fCounters[ id > 0 && id < fNthreads ? id : 0 ];
+  counter.Events.fetch_add( nevents, std::memory_order_relaxed );
+  counter.Steps.fetch_add( nsteps, std::memory_order_relaxed );
+
+  if ( fInterval <= 0 )
+    return;
+
+  G4double elapsed = this -> Elapsed();
+  G4long   next    = fNextReport.load( std::memory_order_relaxed );
+  if ( elapsed < next )
+    return;
+
+  if ( fNextReport.compare_exchange_strong( next, G4long( elapsed + fInterval ),
+					    std::memory_order_relaxed ) )
+    this -> Report( elapsed );
+}
+
+//_______________________________________________________________________________
+// Returns the meter of the run manager. It only exists in the master or sequential
+// run manager, which creates it before the worker threads.
+EMCalProgressMeter* EMCalProgressMeter::GetInstance() { return fInstance; }
+
+//_______________________________________________________________________________
+// Prints the rates of the whole run, and the events processed by each thread
+void EMCalProgressMeter::PrintStatistics() const {
+
+  if ( !fCounters )
+    return;
+
+  G4double elapsed = this -> Elapsed()/s;
+
+  G4long nevents = 0, nsteps = 0;
+  for ( G4int i = 0; i < fNthreads; i++ ) {
+    nevents += fCounters[ i ].Events.load( std::memory_order_relaxed );
+    nsteps  += fCounters[ i ].Steps.load( std::memory_order_relaxed );
+  }
+
+  G4cout << "  Steps processed:   \t" << nsteps << G4endl;
+  if ( elapsed > 0 )
+    G4cout << "  Steps per second:  \t" << nsteps/elapsed << G4endl;
+  if ( nevents > 0 )
+    G4cout << "  Steps per event:   \t" << G4double( nsteps )/nevents << G4endl;
+
+  if ( fNthreads > 1 && elapsed > 0 ) {
+    G4cout << "  Events/s per thread:\t";
+    for ( G4int i = 0; i < fNthreads; i++ )
+      G4cout << std::setprecision( 3 )
+	     << fCounters[ i ].Events.load( std::memory_order_relaxed )/elapsed << " ";
+    G4cout << std::setprecision( 6 ) << G4endl;
+  }
+}
+
+//_______________________________________________________________________________
+// Starts the counters of a new run of < nevents > events processed by < nthreads >
+// threads. It is called by the master before the workers start.
+void EMCalProgressMeter::StartRun( G4int nevents, G4int nthreads ) {
+
+  fNevents  = nevents;
+  fNthreads = nthreads > 0 ? nthreads : 1;
+
+  std::free( fCounters );
+  delete[] fLastEvents;
+
+  // The counters are allocated aligned to the cache lines, since the operator new of
+  // the standard used by Geant4 does not guarantee the alignment of the structure
+  void *counters = 0;
+  if ( posix_memalign( &counters, alignof( Counter ), fNthreads*sizeof( Counter ) ) )
+    G4Exception( "EMCalProgressMeter::StartRun", "EMCalProgressMeter001", FatalException,
+		 "Unable to allocate the counters of the threads" );
+  fCounters   = static_cast<Counter*>( counters );
+  fLastEvents = new G4long[ fNthreads ];
+  for ( G4int i = 0; i < fNthreads; i++ ) {
+    new( fCounters + i ) Counter;
+    fCounters[ i ].Events = 0;
+    fCounters[ i ].Steps  = 0;
+    fLastEvents[ i ]      = 0;
+  }
+
+  fStartTime  = std::chrono::steady_clock::now();
+  fLastReport = 0;
+  fNextReport = G4long( fInterval );
+}
+
+//_______________________________________________________________________________
+// Returns the time since the start of the run
+G4double EMCalProgressMeter::Elapsed() const {
+
+  return std::chrono::duration<G4double, std::nano>
+    ( std::chrono::steady_clock::now() - fStartTime ).count()*ns;
+}
+
+//_______________________________________________________________________________
+// Prints the events processed, the rates since the start of the run and the time
+// expected to finish it. The rates of each thread are those since the previous
+// report, so a thread which has stopped is seen at once.
+void EMCalProgressMeter::Report( G4double elapsed ) {
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  G4long nevents = 0, nsteps = 0;
+  std::vector<G4double> rates( fNthreads );
+  for ( G4int i = 0; i < fNthreads; i++ ) {
+
+    G4long events = fCounters[ i ].Events.load( std::memory_order_relaxed );
+    G4long steps  = fCounters[ i ].Steps.load( std::memory_order_relaxed );
+    nevents += events;
+    nsteps  += steps;
+
+    if ( elapsed > fLastReport )
+      rates[ i ] = ( events - fLastEvents[ i ] )/( ( elapsed - fLastReport )/s );
+    fLastEvents[ i ] = events;
+  }
+  fLastReport = elapsed;
+
+  G4double seconds = elapsed/s;
+  G4double evtRate = nevents/seconds;
+
+  G4cout << " Progress: " << nevents << "/" << fNevents << " events";
+  if ( fNevents > 0 )
+    G4cout << " (" << std::setprecision( 3 ) << 100.*nevents/fNevents << "%)";
+  G4cout << std::setprecision( 3 )
+	 << "  " << evtRate << " events/s  " << nsteps/seconds << " steps/s";
+  if ( evtRate > 0 && fNevents > nevents )
+    G4cout << "  ETA " << G4BestUnit( ( fNevents - nevents )/evtRate*s, "Time" );
+  G4cout << std::setprecision( 6 ) << G4endl;
+
+  if ( fNthreads > 1 ) {
+    G4cout << "  events/s per thread:";
+    for ( G4int i = 0; i < fNthreads; i++ )
+      G4cout << " " << std::setprecision( 3 ) << rates[ i ];
+    G4cout << std::setprecision( 6 ) << G4endl;
+  }
+}
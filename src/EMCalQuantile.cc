@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the Quantile class, which estimates a quantile of a sequence of      //
+//  values without storing them, following the P-square algorithm of Jain and    //
+//  Chlamtac. Five markers are kept, whose heights approach the minimum, the     //
+//  maximum, the quantile and the middle points between them as the values are   //
+//  added.                                                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalQuantile.hh"
+
+#include <algorithm>
+
+
+//_______________________________________________________________________________
+// Constructor
+EMCalQuantile::EMCalQuantile( G4double probability ) : fProbability( probability ) {
+
+  fIncrements[ 0 ] = 0;
+  fIncrements[ 1 ] = 0.5*probability;
+  fIncrements[ 2 ] = probability;
+  fIncrements[ 3 ] = 0.5*( 1 + probability );
+  fIncrements[ 4 ] = 1;
+
+  this -> Reset();
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalQuantile::~EMCalQuantile() { }
+
+//_______________________________________________________________________________
+// Adds the values of another estimator of the same quantile. If any of them has
+// less values than markers they are added one by one, otherwise the heights are
+// averaged weighting by the number of values and the positions are added, which
+// gives an approximation of the quantile of both sequences.
+void EMCalQuantile::Add( const EMCalQuantile &other ) {
+
+  if ( other.fCount < kMarkers ) {
+    for ( G4int i = 0; i < other.fCount; i++ )
+      this -> Fill( other.fHeights[ i ] );
+    return;
+  }
+
+  if ( fCount < kMarkers ) {
+    G4double values[ kMarkers ];
+    G4int    nvalues = fCount;
+    std::copy( fHeights, fHeights + fCount, values );
+    *this = other;
+    for ( G4int i = 0; i < nvalues; i++ )
+      this -> Fill( values[ i ] );
+    return;
+  }
+
+  G4double weight = G4double( other.fCount )/( fCount + other.fCount );
+
+  for ( G4int i = 1; i < kMarkers - 1; i++ )
+    fHeights[ i ] += weight*( other.fHeights[ i ] - fHeights[ i ] );
+  fHeights[ 0 ]            = std::min( fHeights[ 0 ], other.fHeights[ 0 ] );
+  fHeights[ kMarkers - 1 ] = std::max( fHeights[ kMarkers - 1 ], other.fHeights[ kMarkers - 1 ] );
+
+  for ( G4int i = 1; i < kMarkers; i++ ) {
+    fPositions[ i ] += other.fPositions[ i ] + 1;
+    fDesired[ i ]   += other.fDesired[ i ] + fIncrements[ i ];
+  }
+
+  fCount += other.fCount;
+}
+
+//_______________________________________________________________________________
+// Adds a new value. The markers between the one below the value and the last are
+// moved one position, and those far from their desired position are moved to it,
+// adjusting their heights with a parabolic interpolation.
+void EMCalQuantile::Fill( G4double x ) {
+
+  // The first values are stored sorted as the heights of the markers
+  if ( fCount < kMarkers ) {
+    fHeights[ fCount++ ] = x;
+    std::sort( fHeights, fHeights + fCount );
+    return;
+  }
+
+  G4int k;
+  if ( x < fHeights[ 0 ] ) {
+    fHeights[ 0 ] = x;
+    k = 0;
+  }
+  else if ( x >= fHeights[ kMarkers - 1 ] ) {
+    fHeights[ kMarkers - 1 ] = x;
+    k = kMarkers - 2;
+  }
+  else
+    k = std::upper_bound( fHeights, fHeights + kMarkers, x ) - fHeights - 1;
+
+  for ( G4int i = k + 1; i < kMarkers; i++ )
+    fPositions[ i ] += 1;
+  for ( G4int i = 0; i < kMarkers; i++ )
+    fDesired[ i ] += fIncrements[ i ];
+
+  G4double d, h;
+  for ( G4int i = 1; i < kMarkers - 1; i++ ) {
+
+    d = fDesired[ i ] - fPositions[ i ];
+
+    if ( ( d >=  1 && fPositions[ i + 1 ] - fPositions[ i ] >  1 ) ||
+	 ( d <= -1 && fPositions[ i - 1 ] - fPositions[ i ] < -1 ) ) {
+
+      d = d > 0 ? 1 : -1;
+
+      h = fHeights[ i ] + d/( fPositions[ i + 1 ] - fPositions[ i - 1 ] )*
+	( ( fPositions[ i ] - fPositions[ i - 1 ] + d )*
+	  ( fHeights[ i + 1 ] - fHeights[ i ] )/( fPositions[ i + 1 ] - fPositions[ i ] ) +
+	  ( fPositions[ i + 1 ] - fPositions[ i ] - d )*
+	  ( fHeights[ i ] - fHeights[ i - 1 ] )/( fPositions[ i ] - fPositions[ i - 1 ] ) );
+
+      // If the parabolic prediction is not between the neighbours, the height is
+      // interpolated linearly
+      if ( h <= fHeights[ i - 1 ] || h >= fHeights[ i + 1 ] ) {
+	G4int j = i + G4int( d );
+	h = fHeights[ i ] + d*( fHeights[ j ] - fHeights[ i ] )/( fPositions[ j ] - fPositions[ i ] );
+      }
+
+      fHeights[ i ]    = h;
+      fPositions[ i ] += d;
+    }
+  }
+
+  fCount++;
+}
+
+//_______________________________________________________________________________
+// Returns the estimate of the quantile. While there are less values than markers,
+// the closest of the stored values is returned.
+G4double EMCalQuantile::GetValue() const {
+
+  if ( fCount == 0 )
+    return 0;
+  if ( fCount < kMarkers )
+    return fHeights[ G4int( fProbability*( fCount - 1 ) + 0.5 ) ];
+
+  return fHeights[ 2 ];
+}
+
+//_______________________________________________________________________________
+// Removes all the values
+void EMCalQuantile::Reset() {
+
+  fCount = 0;
+
+  for ( G4int i = 0; i < kMarkers; i++ ) {
+    fHeights[ i ]   = 0;
+    fPositions[ i ] = i;
+  }
+
+  fDesired[ 0 ] = 0;
+  fDesired[ 1 ] = 2*fProbability;
+  fDesired[ 2 ] = 4*fProbability;
+  fDesired[ 3 ] = 2 + 2*fProbability;
+  fDesired[ 4 ] = 4;
+}
@@ -18,30 +18,98 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 
+#include "G4DynamicParticle.hh"
 #include "G4ParticleGun.hh"
+#include "G4Step.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
 
 #include "EMCalDetectorConstruction.hh"
 #include "EMCalPrimaryGeneratorAction.hh"
 #include "EMCalRun.hh"
 
+#include "TFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sys/resource.h>
+
+
+//_______________________________________________________________________________
+// Returns the middle point of the step in the frame of the volume where it starts
+static inline G4ThreeVector LocalPosition( const G4Step *step ) {
+
+  const G4StepPoint *prePoint = step -> GetPreStepPoint();
+
+  return prePoint -> GetTouchableHandle() -> GetHistory() ->
+    GetTopTransform().TransformPoint( ( prePoint -> GetPosition() +
+					step -> GetPostStepPoint() -> GetPosition() )*0.5 );
+}
 
 //_______________________________________________________________________________
 // Constructor
 EMCalRun::EMCalRun() :
   G4Run(),
   fOutputTree( 0 ),
+  fFlushEntries( 100000 ),
+  fFlushFile( false ),
+  fWriter( 0 ),
   fDetectorEnergy( 0 ),
+  fEventNumber( 0 ),
+  fEscapedEnergy( 0 ),
   fLostEnergy( 0 ),
   fNdetHits( 0 ),
   fNsgvHits( 0 ),
   fSGVolumeEnergy( 0 ),
   fTrueEnergy( 0 ),
-  fVariablesVector( 0 ) {
+  fVariablesVector( 0 ),
+  fSumDetectorEnergy( 0 ),
+  fSumDetectorEnergy2( 0 ),
+  fSumEscapedEnergy( 0 ),
+  fSumLostEnergy( 0 ),
+  fSelecting( false ),
+  fSelectLeakage( 0 ),
+  fSelectModules( 0 ),
+  fPeakOverflow( 0 ),
+  fPeakStacked( 0 ),
+  fStartTime( std::chrono::steady_clock::now() ),
+  fNtimedEvents( 0 ),
+  fSumCpuTime( 0 ),
+  fSumWallTime( 0 ),
+  fWallTimeMedian( 0.5 ),
+  fWallTimeTail( 0.99 ),
+  fNtouched( 0 ),
+  fTouchedModules( 0 ),
+  fTouchedFlags( 0 ),
+  fAggregate( 0 ),
+  fNstepOptions( 0 ),
+  fPulses( false ),
+  fInvTimeBinWidth( 0 ),
+  fGateFirstBin( 0 ),
+  fGateLastBin( 0 ),
+  fModPulse( 0 ),
+  fGateEnergy( 0 ),
+  fOutOfGateEnergy( 0 ),
+  fNpulses( 0 ),
+  fQuench( false ),
+  fQuenchedEnergy( 0 ),
+  fNsubCells( 1 ),
+  fNcells( 0 ),
+  fFillProfiles( false ),
+  fFrontFace( 0 ),
+  fPrimaryDirection( 0, 0, 1 ),
+  fStepHits( 0 ),
+  fStepTree( 0 ),
+  fStepEvent( 0 ),
+  fNstepHits( 0 ),
+  fStepCapacity( 0 ) {
 
   // Gets the detector
   const EMCalDetectorConstruction *detector
     = static_cast<const EMCalDetectorConstruction*>
     ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+  fDetector = detector;
 
   // The title depends if shower-generator volume is enabled or not
   if ( detector -> SGVenabled() )
@@ -51,11 +119,30 @@ EMCalRun::EMCalRun() :
 
   fNbranches       = detector -> GetNmodules();
   fVariablesVector = new EMCalRun::PhysicalVariables[ fNbranches ];
+  fTouchedModules  = new size_t[ fNbranches ];
+  fTouchedFlags    = new G4bool[ fNbranches ];
+  std::fill( fTouchedFlags, fTouchedFlags + fNbranches, false );
+
+  // If the detectors are divided in sub-cells, the output arrays can hold all of them
+  fNsubCells = detector -> GetNsubCells();
+  if ( fNsubCells > 1 ) {
+    fSubCellEnergy.assign( fNbranches*fNsubCells, 0. );
+    fCellModule.assign( fNbranches*fNsubCells, 0 );
+    fCellIndex.assign( fNbranches*fNsubCells, 0 );
+    fCellEnergy.assign( fNbranches*fNsubCells, 0. );
+  }
 } 
 
 //_______________________________________________________________________________
 // Destructor
-EMCalRun::~EMCalRun() { delete[] fVariablesVector; }
+EMCalRun::~EMCalRun() {
+
+  delete[] fVariablesVector;
+  delete[] fTouchedModules;
+  delete[] fTouchedFlags;
+  delete fStepHits;
+  delete[] fModPulse;
+}
 
 //_______________________________________________________________________________
 // Constructor for the nested class
@@ -66,6 +153,236 @@ EMCalRun::PhysicalVariables::PhysicalVariables() :
 // Destructor for the nested class
 EMCalRun::PhysicalVariables::~PhysicalVariables() { }
  
+//_______________________________________________________________________________
+// Adds the energy deposited in the step to the readout sub-cell of the detector
+// < idet > where its middle point lies. The sub-cells with energy deposited are
+// saved, so only these are written and reset.
+void EMCalRun::AddEnergyToSubCell( const G4Step *step, G4int idet ) {
+
+  G4double edep = step -> GetTotalEnergyDeposit();
+  if ( edep == 0. )
+    return;
+
+  G4int icell = idet*fNsubCells + fDetector -> GetSubCell( LocalPosition( step ) );
+
+  if ( fSubCellEnergy[ icell ] == 0. )
+    fTouchedSubCells.push_back( icell );
+  fSubCellEnergy[ icell ] += edep;
+}
+
+//_______________________________________________________________________________
+// Adds the wall and CPU time, in seconds, taken by an event
+void EMCalRun::AddEventTime( G4double wall, G4double cpu ) {
+
+  fNtimedEvents++;
+  fSumCpuTime  += cpu;
+  fSumWallTime += wall;
+
+  fWallTimeMedian.Fill( wall );
+  fWallTimeTail.Fill( wall );
+}
+
+//_______________________________________________________________________________
+// Option of the steps adding their energy to the pulse of the module, for those in
+// the detectors
+void EMCalRun::AddPulseOption( const G4Step                         *step,
+			       G4int                                 module,
+			       EMCalDetectorConstruction::VolumeType type ) {
+  if ( type == EMCalDetectorConstruction::kDetector )
+    this -> AddPulse( step -> GetTotalEnergyDeposit(),
+		      step -> GetPreStepPoint() -> GetGlobalTime(), module );
+}
+
+//_______________________________________________________________________________
+// Option of the steps adding their visible energy, for those in the detectors
+void EMCalRun::AddQuenchedEnergyOption( const G4Step                         *step,
+					G4int,
+					EMCalDetectorConstruction::VolumeType type ) {
+  if ( type == EMCalDetectorConstruction::kDetector )
+    this -> AddQuenchedEnergy( step );
+}
+
+//_______________________________________________________________________________
+// Option of the steps adding their energy to the readout sub-cells, for those in the
+// detectors
+void EMCalRun::AddEnergyToSubCellOption( const G4Step                         *step,
+					 G4int                                 module,
+					 EMCalDetectorConstruction::VolumeType type ) {
+  if ( type == EMCalDetectorConstruction::kDetector )
+    this -> AddEnergyToSubCell( step, module );
+}
+
+//_______________________________________________________________________________
+// Option of the steps filling the shower profiles
+void EMCalRun::FillProfilesOption( const G4Step *step,
+				   G4int,
+				   EMCalDetectorConstruction::VolumeType ) {
+  this -> FillProfiles( step );
+}
+
+//_______________________________________________________________________________
+// Gets the energy deposited in the modules in the current event. The configuration
+// of the geometry is given as template parameters, so the instantiation is selected
+// once per run and the loops do not check it.
+template<G4bool sgv, G4bool grid>
+void EMCalRun::Aggregate() {
+
+  // With only one module there are no branches for the modules, so its variables
+  // give directly the calorimeter variables
+  if ( !grid ) {
+
+    fDetectorEnergy = fVariablesVector[ 0 ].DetectorEnergy;
+    fNdetHits       = ( fDetectorEnergy > 0. );
+    if ( sgv ) {
+      fSGVolumeEnergy = fVariablesVector[ 0 ].SGVolumeEnergy;
+      fNsgvHits       = ( fSGVolumeEnergy > 0. );
+    }
+    return;
+  }
+
+  // Gets the energy deposited in each module. Only the touched modules can have
+  // energy deposited. They are visited in increasing order, so the sums are the same
+  // as if all the modules were visited.
+  std::sort( fTouchedModules, fTouchedModules + fNtouched );
+
+  G4double ModDetectorEnergy, ModSGVolumeEnergy;
+  size_t   idet;
+
+  for ( size_t itch = 0; itch < fNtouched; itch++ ) {
+
+    idet = fTouchedModules[ itch ];
+
+    ModDetectorEnergy = fVariablesVector[ idet ].DetectorEnergy;
+    fDetectorEnergy += ModDetectorEnergy;
+    if ( ModDetectorEnergy > 0. )
+      fNdetHits++;
+
+    if ( sgv ) {
+      ModSGVolumeEnergy = fVariablesVector[ idet ].SGVolumeEnergy;
+      fSGVolumeEnergy += ModSGVolumeEnergy;
+      if ( ModSGVolumeEnergy > 0. )
+	fNsgvHits++;
+    }
+  }
+}
+
+//_______________________________________________________________________________
+// Configures the profiles of the shower with < nbins > bins. The depth goes from the
+// front face to the back of the calorimeter and the distance to the axis of the
+// primary particle from zero to the transverse half diagonal.
+void EMCalRun::EnableProfiles( G4int nbins ) {
+
+  const EMCalDetectorConstruction *detector
+    = static_cast<const EMCalDetectorConstruction*>
+    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+
+  G4ThreeVector hlengths = detector -> GetHalfLengths();
+
+  fFillProfiles = true;
+  fFrontFace    = detector -> GetDistance();
+  fLongitudinalProfile.Configure( nbins, 0, 2*hlengths.z() );
+  fLateralProfile.Configure( nbins, 0, std::sqrt( hlengths.x()*hlengths.x() +
+						  hlengths.y()*hlengths.y() ) );
+}
+
+//_______________________________________________________________________________
+// Enables the time binning of the energy deposited in the detectors, with bins of
+// width < width >. The gate starts at < start > and lasts < length >, both rounded
+// to the bin edges.
+void EMCalRun::EnablePulses( G4double width, G4double start, G4double length ) {
+
+  fPulses          = true;
+  fInvTimeBinWidth = 1./width;
+  fGateFirstBin    = std::min( size_t( std::max( start/width, 0. ) + 0.5 ), kTimeBins );
+  fGateLastBin     = std::min( size_t( std::max( ( start + length )/width, 0. ) + 0.5 ),
+			       kTimeBins );
+
+  if ( !fModPulse )
+    fModPulse = new G4double[ fNbranches*( kTimeBins + 1 ) ]();
+
+  fPulseModule.assign( fNbranches, 0 );
+  fPulseGateEnergy.assign( fNbranches, 0. );
+}
+
+//_______________________________________________________________________________
+// Builds the Birks tables for the detector material, so the visible energy is
+// computed for each step in the detectors
+void EMCalRun::EnableQuenching( const G4Material *material, G4double birks ) {
+
+  fBirksTable.Build( material, birks );
+  fQuench = true;
+}
+
+//_______________________________________________________________________________
+// Creates the branches of the tree where the step hits are written. The steps of
+// an event are stored as arrays, with the same entry as the event in the output tree.
+void EMCalRun::EnableStepRecording( TTree *tree ) {
+
+  fStepTree = tree;
+
+  fStepTree -> Branch( "EventNumber", &fStepEvent, "EventNumber/I" );
+  fStepTree -> Branch( "nSteps"     , &fNstepHits, "nSteps/I"      );
+
+  fStepCapacity = 1024;
+  this -> SetStepBranchAddresses();
+
+  delete fStepHits;
+  fStepHits = new EMCalStepHitsCollection( "EMCalRun", "EMCalStepHitsCollection" );
+}
+
+//_______________________________________________________________________________
+// Writes the step hits of the current event. The buffers are enlarged if the event
+// has more steps than they can hold.
+void EMCalRun::FillStepTree( const G4int &evtNb ) {
+
+  size_t nsteps = fStepHits -> entries();
+  if ( nsteps > fStepCapacity ) {
+    fStepCapacity = std::max( 2*fStepCapacity, nsteps );
+    this -> SetStepBranchAddresses();
+  }
+
+  fStepEvent = evtNb;
+  fNstepHits = nsteps;
+
+  for ( size_t istep = 0; istep < nsteps; istep++ ) {
+
+    const EMCalStepHit  *hit = ( *fStepHits )[ istep ];
+    const G4ThreeVector &pos = hit -> GetLocalPosition();
+
+    fStepModule[ istep ] = hit -> GetModule();
+    fStepType[ istep ]   = ( hit -> GetType() == EMCalDetectorConstruction::kSGVolume );
+    fStepX[ istep ]      = pos.x()/mm;
+    fStepY[ istep ]      = pos.y()/mm;
+    fStepZ[ istep ]      = pos.z()/mm;
+    fStepTime[ istep ]   = hit -> GetTime()/ns;
+    fStepEnergy[ istep ] = hit -> GetEnergy()/MeV;
+    fStepPDG[ istep ]    = hit -> GetPDG();
+  }
+
+  fStepTree -> Fill();
+}
+
+//_______________________________________________________________________________
+// Saves the energy deposited in the modules by the sub-event which has been
+// processed, so it is added to the event which created it
+void EMCalRun::ExportSubEvent( EMCalSubEvent *subEvent ) const {
+
+  size_t idet;
+  for ( size_t itch = 0; itch < fNtouched; itch++ ) {
+
+    idet = fTouchedModules[ itch ];
+
+    subEvent -> AddModule( idet,
+			   fVariablesVector[ idet ].DetectorEnergy,
+			   fVariablesVector[ idet ].SGVolumeEnergy,
+			   fVariablesVector[ idet ].nDetInteractions,
+			   fVariablesVector[ idet ].nSgvInteractions );
+  }
+
+  subEvent -> AddEscapedEnergy( fEscapedEnergy );
+  subEvent -> AddQuenchedEnergy( fQuenchedEnergy );
+}
+
 //_______________________________________________________________________________
 // Fills the tree with the information of the current event
 void EMCalRun::Fill( const G4int &evtNb ) {
@@ -76,70 +393,374 @@ void EMCalRun::Fill( const G4int &evtNb ) {
     ( G4RunManager::GetRunManager() -> GetUserPrimaryGeneratorAction() );
   const G4ParticleGun* particleGun = generatorAction -> GetParticleGun();
 
-  // Gets the pointer to the detector
-  const EMCalDetectorConstruction *detector
-    = static_cast<const EMCalDetectorConstruction*>
-    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
-
   // Sets to zero the calorimeter variables and gets the energy of the incident particle
   fDetectorEnergy = 0;
+  fEventNumber    = evtNb;
   fLostEnergy     = 0;
   fNdetHits       = 0;
   fNsgvHits       = 0;
   fSGVolumeEnergy = 0;
   fTrueEnergy     = particleGun -> GetParticleEnergy();
 
-  // Gets the energy deposited in each module
-  G4double ModDetectorEnergy, ModSGVolumeEnergy;
+  // Gets the energy deposited in the modules, using the kernel selected for the
+  // geometry of this run
+  ( this ->* fAggregate )();
 
-  if ( detector -> SGVenabled() )
-    for ( size_t idet = 0; idet < fNbranches; idet++ ) {
+  // Copies the sub-cells with energy deposited to the output arrays, in increasing
+  // order of module and sub-cell
+  if ( fNsubCells > 1 ) {
 
-      ModDetectorEnergy = fVariablesVector[ idet ].DetectorEnergy;
-      fDetectorEnergy += ModDetectorEnergy;
-      if ( ModDetectorEnergy > 0. )
-	fNdetHits++;
+    std::sort( fTouchedSubCells.begin(), fTouchedSubCells.end() );
 
-      ModSGVolumeEnergy = fVariablesVector[ idet ].SGVolumeEnergy;
-      fSGVolumeEnergy += ModSGVolumeEnergy;
-      if ( ModSGVolumeEnergy > 0. )
-	fNsgvHits++;
+    fNcells = fTouchedSubCells.size();
+    for ( G4int icell = 0; icell < fNcells; icell++ ) {
+      fCellModule[ icell ] = fTouchedSubCells[ icell ]/fNsubCells;
+      fCellIndex[ icell ]  = fTouchedSubCells[ icell ]%fNsubCells;
+      fCellEnergy[ icell ] = fSubCellEnergy[ fTouchedSubCells[ icell ] ];
     }
-  else
-    for ( size_t idet = 0; idet < fNbranches; idet++ ) {
+  }
+
+  // Integrates the pulses of the modules with energy deposited inside and outside
+  // the gate. The modules touched only in the shower-generator volume, or without
+  // energy in the detector, have no pulse.
+  if ( fPulses ) {
 
-      ModDetectorEnergy = fVariablesVector[ idet ].DetectorEnergy;
-      fDetectorEnergy += ModDetectorEnergy;
-      if ( ModDetectorEnergy > 0. )
-	fNdetHits++;
+    fGateEnergy      = 0;
+    fOutOfGateEnergy = 0;
+    fNpulses         = 0;
+
+    G4double gate, total;
+    for ( size_t itch = 0; itch < fNtouched; itch++ ) {
+
+      size_t idet = fTouchedModules[ itch ];
+      if ( !( fVariablesVector[ idet ].DetectorEnergy > 0. ) )
+	continue;
+
+      const G4double *pulse = fModPulse + idet*( kTimeBins + 1 );
+
+      gate = total = 0;
+      for ( size_t ibin = 0; ibin < kTimeBins + 1; ibin++ ) {
+	total += pulse[ ibin ];
+	if ( ibin >= fGateFirstBin && ibin < fGateLastBin )
+	  gate += pulse[ ibin ];
+      }
+
+      fPulseModule[ fNpulses ]     = idet;
+      fPulseGateEnergy[ fNpulses ] = gate;
+      fGateEnergy                 += gate;
+      fOutOfGateEnergy            += total - gate;
+      fNpulses++;
     }
-    
-  // Calculates the energy lost by the calorimeter
+  }
+
+  // Calculates the energy lost by the calorimeter. It includes the energy of the
+  // tracks killed out of the envelope of the modules, since they can not deposit
+  // energy in the detectors.
   fLostEnergy = fTrueEnergy - fDetectorEnergy;
 
-  // Fills the output tree
+  // Adds the event to the statistics of the run
+  fSumDetectorEnergy  += fDetectorEnergy;
+  fSumDetectorEnergy2 += fDetectorEnergy*fDetectorEnergy;
+  fSumEscapedEnergy   += fEscapedEnergy;
+  fSumLostEnergy      += fLostEnergy;
+
+  // Saves the number of the event if it passes the selection
+  if ( fSelecting &&
+       ( ( fSelectLeakage > 0 && fLostEnergy > fSelectLeakage*fTrueEnergy ) ||
+	 ( fSelectModules > 0 && fNdetHits >= fSelectModules ) ) )
+    fSelectedEvents.push_back( evtNb );
+
+  // Fills the output tree, or sends the event to the thread filling it. In the latter
+  // case the tree is also saved by the writer. The run action does not create the
+  // writer when the steps are recorded, so no step records are lost here.
+  if ( fWriter ) {
+    fWriter -> Push();
+    return;
+  }
+
   fOutputTree -> Fill();
 
-  // Autosaves the output tree each certain time
-  if ( evtNb % 100000 == 0 ) {
+  // Writes the steps of the event if they are recorded
+  if ( fStepTree )
+    this -> FillStepTree( evtNb );
+
+  // Autosaves the output tree each certain number of entries. If the file is
+  // buffered, it is written, sending the entries to be merged in the output file.
+  // The tree of the steps is saved with it, so a file recovered after a crash has
+  // the steps of all its events.
+  if ( fFlushEntries > 0 && fOutputTree -> GetEntries() % fFlushEntries == 0 ) {
+
+    if ( fFlushFile )
+      fOutputTree -> GetCurrentFile() -> Write();
+    else {
+      G4cout << "\n ******************************* "   << G4endl;
+      G4cout <<   " **** Autosaving output tree *** "   << G4endl;
+      G4cout <<   " ******************************* \n" << G4endl;
+      fOutputTree -> AutoSave();
+      if ( fStepTree )
+	fStepTree -> AutoSave();
+    }
+  }
+}
+
+//_______________________________________________________________________________
+// Adds the energy deposited in the step to the profiles, at the middle point of
+// the step
+void EMCalRun::FillProfiles( const G4Step *step ) {
+
+  G4double edep = step -> GetTotalEnergyDeposit();
+  if ( edep == 0. )
+    return;
+
+  G4ThreeVector position = ( step -> GetPreStepPoint() -> GetPosition() +
+			     step -> GetPostStepPoint() -> GetPosition() )*0.5;
+
+  fLongitudinalProfile.Fill( position.z() - fFrontFace, edep );
+  fLateralProfile.Fill( ( position - fPrimaryOrigin ).cross( fPrimaryDirection ).mag(), edep );
+}
+
+//_______________________________________________________________________________
+// Adds the statistics, the selected and slow events and the profiles of the run of
+// a worker thread to this one. The peaks of the stack are the maximum of all the
+// threads.
+void EMCalRun::Merge( const G4Run *run ) {
+
+  const EMCalRun *localRun = static_cast<const EMCalRun*>( run );
+
+  fSumDetectorEnergy  += localRun -> fSumDetectorEnergy;
+  fSumDetectorEnergy2 += localRun -> fSumDetectorEnergy2;
+  fSumEscapedEnergy   += localRun -> fSumEscapedEnergy;
+  fSumLostEnergy      += localRun -> fSumLostEnergy;
+
+  fPeakOverflow = std::max( fPeakOverflow, localRun -> fPeakOverflow );
+  fPeakStacked  = std::max( fPeakStacked, localRun -> fPeakStacked );
+
+  fSelectedEvents.insert( fSelectedEvents.end(),
+			  localRun -> fSelectedEvents.begin(),
+			  localRun -> fSelectedEvents.end() );
+
+  fNtimedEvents += localRun -> fNtimedEvents;
+  fSumCpuTime   += localRun -> fSumCpuTime;
+  fSumWallTime  += localRun -> fSumWallTime;
+  fWallTimeMedian.Add( localRun -> fWallTimeMedian );
+  fWallTimeTail.Add( localRun -> fWallTimeTail );
+  fSlowEvents.insert( fSlowEvents.end(),
+		      localRun -> fSlowEvents.begin(),
+		      localRun -> fSlowEvents.end() );
+
+  if ( fFillProfiles && localRun -> fFillProfiles ) {
+    fLongitudinalProfile.Add( localRun -> fLongitudinalProfile );
+    fLateralProfile.Add( localRun -> fLateralProfile );
+  }
+
+  G4Run::Merge( run );
+}
+
+//_______________________________________________________________________________
+// Adds the energy deposited by a sub-event, processed by another thread, to the
+// current event
+void EMCalRun::MergeSubEvent( const EMCalSubEvent *subEvent ) {
+
+  const std::vector<EMCalSubEvent::Module> &modules = subEvent -> GetModules();
 
-    G4cout << "\n ******************************* "   << G4endl;
-    G4cout <<   " **** Autosaving output tree *** "   << G4endl;
-    G4cout <<   " ******************************* \n" << G4endl;
-    fOutputTree -> AutoSave();
+  for ( size_t imod = 0; imod < modules.size(); imod++ ) {
+
+    const EMCalSubEvent::Module &module = modules[ imod ];
+
+    if ( module.nDetInteractions > 0 )
+      this -> AddEnergyToDetector( module.DetectorEnergy, module.Index, module.nDetInteractions );
+    if ( module.nSgvInteractions > 0 )
+      this -> AddEnergyToSGVolume( module.SGVolumeEnergy, module.Index, module.nSgvInteractions );
   }
+
+  fEscapedEnergy  += subEvent -> GetEscapedEnergy();
+  fQuenchedEnergy += subEvent -> GetQuenchedEnergy();
+}
+
+//_______________________________________________________________________________
+// Prints the mean and the standard deviation of the energy deposited in the
+// detectors, and the mean energy lost, for all the events of the run. The number of
+// events per second and the memory taken by the tracks are also printed. The memory
+// of a thread is estimated from its maximum number of tracks, while the peak memory
+// of the process is given by the system.
+void EMCalRun::PrintStatistics() const {
+
+  if ( numberOfEvent == 0 )
+    return;
+
+  G4double mean = fSumDetectorEnergy/numberOfEvent;
+  G4double rms2 = fSumDetectorEnergy2/numberOfEvent - mean*mean;
+  G4double rms  = rms2 > 0. ? std::sqrt( rms2 ) : 0.;
+
+  G4cout << "  Number of events:  \t" << numberOfEvent << G4endl;
+  G4cout << "  Detector energy:   \t" << G4BestUnit( mean, "Energy" )
+	 << " +- " << G4BestUnit( rms, "Energy" ) << G4endl;
+  G4cout << "  Lost energy:       \t"
+	 << G4BestUnit( fSumLostEnergy/numberOfEvent, "Energy" ) << G4endl;
+  if ( fSumEscapedEnergy > 0 )
+    G4cout << "  Escaped energy:    \t"
+	   << G4BestUnit( fSumEscapedEnergy/numberOfEvent, "Energy" ) << G4endl;
+
+  G4double time = std::chrono::duration<G4double>
+    ( std::chrono::steady_clock::now() - fStartTime ).count();
+  if ( time > 0 )
+    G4cout << "  Events per second: \t" << numberOfEvent/time << G4endl;
+
+  if ( fNtimedEvents > 0 ) {
+    G4cout << "  Time per event:    \t" << fSumWallTime/fNtimedEvents << " s ( CPU "
+	   << fSumCpuTime/fNtimedEvents << " s )" << G4endl;
+    G4cout << "  Median, 99% time:  \t" << fWallTimeMedian.GetValue() << " s, "
+	   << fWallTimeTail.GetValue() << " s" << G4endl;
+    G4cout << "  Slow events:       \t" << fSlowEvents.size() << G4endl;
+  }
+
+  G4double trackMemory = fPeakStacked*( sizeof( G4Track ) + sizeof( G4DynamicParticle ) ) +
+    fPeakOverflow*sizeof( EMCalSubEvent::Track );
+
+  G4cout << "  Peak stacked tracks:\t" << fPeakStacked << " ( "
+	 << fPeakOverflow << " out of the stack ) per thread" << G4endl;
+  G4cout << "  Peak track memory: \t" << trackMemory/1024. << " kB per thread" << G4endl;
+
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    G4cout << "  Peak process memory:\t" << usage.ru_maxrss/1024. << " MB" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Sets the addresses of the array branches of the step tree, creating them if they
+// do not exist. It is called each time the buffers are resized.
+void EMCalRun::SetStepBranchAddresses() {
+
+  fStepModule.resize( fStepCapacity );
+  fStepType.resize( fStepCapacity );
+  fStepX.resize( fStepCapacity );
+  fStepY.resize( fStepCapacity );
+  fStepZ.resize( fStepCapacity );
+  fStepTime.resize( fStepCapacity );
+  fStepEnergy.resize( fStepCapacity );
+  fStepPDG.resize( fStepCapacity );
+
+  if ( !fStepTree -> GetBranch( "Module" ) ) {
+    fStepTree -> Branch( "Module", &fStepModule[ 0 ], "Module[nSteps]/I" );
+    fStepTree -> Branch( "SGV"   , &fStepType[ 0 ]  , "SGV[nSteps]/B"    );
+    fStepTree -> Branch( "X"     , &fStepX[ 0 ]     , "X[nSteps]/F"      );
+    fStepTree -> Branch( "Y"     , &fStepY[ 0 ]     , "Y[nSteps]/F"      );
+    fStepTree -> Branch( "Z"     , &fStepZ[ 0 ]     , "Z[nSteps]/F"      );
+    fStepTree -> Branch( "Time"  , &fStepTime[ 0 ]  , "Time[nSteps]/F"   );
+    fStepTree -> Branch( "Energy", &fStepEnergy[ 0 ], "Energy[nSteps]/F" );
+    fStepTree -> Branch( "PDG"   , &fStepPDG[ 0 ]   , "PDG[nSteps]/I"    );
+  }
+  else {
+    fStepTree -> SetBranchAddress( "Module", &fStepModule[ 0 ] );
+    fStepTree -> SetBranchAddress( "SGV"   , &fStepType[ 0 ]   );
+    fStepTree -> SetBranchAddress( "X"     , &fStepX[ 0 ]      );
+    fStepTree -> SetBranchAddress( "Y"     , &fStepY[ 0 ]      );
+    fStepTree -> SetBranchAddress( "Z"     , &fStepZ[ 0 ]      );
+    fStepTree -> SetBranchAddress( "Time"  , &fStepTime[ 0 ]   );
+    fStepTree -> SetBranchAddress( "Energy", &fStepEnergy[ 0 ] );
+    fStepTree -> SetBranchAddress( "PDG"   , &fStepPDG[ 0 ]    );
+  }
+}
+
+//_______________________________________________________________________________
+// Selects the kernel to get the energy deposited in the modules, given whether the
+// shower-generator volumes are enabled and whether there is more than one module.
+// The options applied to the steps are also listed, in the order they were checked
+// before, so the kernels of the steps only go through those enabled.
+void EMCalRun::SelectKernels( G4bool sgv, G4bool grid ) {
+
+  if ( sgv )
+    fAggregate = grid ? &EMCalRun::Aggregate<true, true> : &EMCalRun::Aggregate<true, false>;
+  else
+    fAggregate = grid ? &EMCalRun::Aggregate<false, true> : &EMCalRun::Aggregate<false, false>;
+
+  fNstepOptions = 0;
+  if ( this -> PulsesEnabled() )
+    fStepOptions[ fNstepOptions++ ] = &EMCalRun::AddPulseOption;
+  if ( this -> QuenchingEnabled() )
+    fStepOptions[ fNstepOptions++ ] = &EMCalRun::AddQuenchedEnergyOption;
+  if ( this -> SegmentationEnabled() )
+    fStepOptions[ fNstepOptions++ ] = &EMCalRun::AddEnergyToSubCellOption;
+  if ( this -> RecordingSteps() )
+    fStepOptions[ fNstepOptions++ ] = &EMCalRun::RecordStep;
+  if ( this -> FillingProfiles() )
+    fStepOptions[ fNstepOptions++ ] = &EMCalRun::FillProfilesOption;
+}
+
+//_______________________________________________________________________________
+// Stores a step that deposited energy in the volume of type < type > of the module
+// < module >. The position is saved in the frame of the volume.
+void EMCalRun::RecordStep( const G4Step                         *step,
+			   G4int                                 module,
+			   EMCalDetectorConstruction::VolumeType type ) {
+
+  G4double edep = step -> GetTotalEnergyDeposit();
+  if ( edep == 0. )
+    return;
+
+  fStepHits -> insert( new EMCalStepHit( module, type, LocalPosition( step ),
+					 step -> GetPreStepPoint() -> GetGlobalTime(), edep,
+					 step -> GetTrack() -> GetDefinition() ->
+					 GetPDGEncoding() ) );
+}
+
+//_______________________________________________________________________________
+// Counts the event in the run. The sub-events of other threads are not counted,
+// since they are part of an event.
+void EMCalRun::RecordEvent( const G4Event *event ) {
+
+  if ( !EMCalSubEvent::GetCurrent() )
+    G4Run::RecordEvent( event );
 }
 
 //_______________________________________________________________________________
 // Resets the information collected in the last event ( sets the variables to
-// zero )
+// zero ). Only the modules touched in the last event need to be reset.
 void EMCalRun::Reset() {
 
-  for ( size_t idet = 0; idet < fNbranches; idet++ ) {
+  size_t idet;
+  for ( size_t itch = 0; itch < fNtouched; itch++ ) {
+
+    idet = fTouchedModules[ itch ];
 
     fVariablesVector[ idet ].DetectorEnergy   = 0;
     fVariablesVector[ idet ].SGVolumeEnergy   = 0;
     fVariablesVector[ idet ].nDetInteractions = 0;
     fVariablesVector[ idet ].nSgvInteractions = 0;
+    fTouchedFlags[ idet ]                     = false;
+
+    if ( fPulses )
+      std::memset( fModPulse + idet*( kTimeBins + 1 ), 0, ( kTimeBins + 1 )*sizeof( G4double ) );
+  }
+  fNtouched = 0;
+
+  fEscapedEnergy  = 0;
+  fQuenchedEnergy = 0;
+
+  for ( size_t icell = 0; icell < fTouchedSubCells.size(); icell++ )
+    fSubCellEnergy[ fTouchedSubCells[ icell ] ] = 0;
+  fTouchedSubCells.clear();
+
+  // The hits of the last event are given back to the allocator
+  if ( fStepTree ) {
+    delete fStepHits;
+    fStepHits = new EMCalStepHitsCollection( "EMCalRun", "EMCalStepHitsCollection" );
   }
 }
+
+//_______________________________________________________________________________
+// Writes the profiles as histograms in the current directory
+void EMCalRun::WriteProfiles() const {
+
+  TH1D *hist;
+
+  hist = fLongitudinalProfile.MakeHistogram( "LongitudinalProfile",
+					     "Longitudinal profile;Depth [mm];Energy [MeV]" );
+  hist -> Write();
+  delete hist;
+
+  hist = fLateralProfile.MakeHistogram( "LateralProfile",
+					"Lateral profile;Distance to axis [mm];Energy [MeV]" );
+  hist -> Write();
+  delete hist;
+}
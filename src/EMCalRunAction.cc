@@ -24,24 +24,91 @@
 #include "EMCalRunAction.hh"
 #include "EMCalPrimaryGeneratorAction.hh"
 #include "EMCalDetectorConstruction.hh"
+#include "EMCalMTRunManager.hh"
 #include "EMCalRun.hh"
+#include "EMCalSteppingAction.hh"
 
 #include "G4RunManager.hh"
+#include "G4Threading.hh"
 #include "G4LogicalVolumeStore.hh"
 #include "G4LogicalVolume.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
 
+#include "TFileMerger.h"
+#include "TParameter.h"
+#include "TSystem.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+//_______________________________________________________________________________
+// Seed and number of the first event of the current run, shared by all the threads
+G4int  EMCalRunAction::fRunFirstEvent = 0;
+G4long EMCalRunAction::fRunSeed       = 0;
 
 //_______________________________________________________________________________
-// Constructor
-EMCalRunAction::EMCalRunAction() :
+// Numbers of the events to be simulated when an interrupted run is resumed, or when
+// the selected events are replayed
+std::vector<G4int> EMCalRunAction::fPendingEvents;
+
+//_______________________________________________________________________________
+// Maximum number of files of the worker threads looked for when a run is resumed
+static const G4int kMaxShards = 1024;
+
+#ifdef EMCAL_BUFFER_MERGER
+//_______________________________________________________________________________
+// Merger of the output file in buffered mode, created by the master at the
+// beginning of each run
+EMCalBufferMerger *EMCalRunAction::fBufferMerger = 0;
+#endif
+
+//_______________________________________________________________________________
+// Constructor. The stepping action is only given for the worker threads.
+EMCalRunAction::EMCalRunAction( EMCalSteppingAction *steppingAction ) :
   G4UserRunAction(),
+  fBufferedOutput( false ),
+  fFileCreated( false ),
+  fFileName( "EMCalorimeter_Results.root" ),
+  fFlushEntries( 100000 ),
   fOutputFile( 0 ),
   fOutputTree( 0 ),
-  fTreeName( "DecayTree" ) {
+  fTreeName( "DecayTree" ),
+  fGateLength( 0 ),
+  fGateStart( 0 ),
+  fProfileBins( 0 ),
+  fRecordSteps( false ),
+  fSteppingAction( steppingAction ),
+  fStepTree( 0 ),
+  fTimeBinWidth( 0 ),
+  fWriter( 0 ),
+  fWriterQueue( 0 ),
+  fWritingBuffer( false ),
+  fFirstEvent( 0 ),
+  fSeed( 0 ),
+  fNprocesses( 1 ),
+  fProcessIndex( -1 ),
+  fCheckpoint( false ),
+  fNrecovered( 0 ),
+  fSelectLeakage( 0 ),
+  fSelectModules( 0 ),
+  fSelectionFile( "" ),
+  fSlowEventFile( "" ),
+  fProgressMeter( 0 ) {
 
   fMessenger = new EMCalRunActionMessenger( this );
+
+  fRunManagerType = G4RunManager::GetRunManager() -> GetRunManagerType();
+  if ( fRunManagerType != G4RunManager::workerRM )
+    fProgressMeter = new EMCalProgressMeter;
 }
 
 //_______________________________________________________________________________
@@ -49,82 +116,1005 @@ EMCalRunAction::EMCalRunAction() :
 EMCalRunAction::~EMCalRunAction() {
 
   delete fMessenger;
+  delete fProgressMeter;
+  delete fWriter;
 
   if ( fOutputFile )
     fOutputFile -> Close();
 }
 
+//_______________________________________________________________________________
+// Creates a branch in the output tree for the variable at < address >, an array of
+// < n > elements whose number in each event is < count >. If the tree is filled by
+// the writer thread, the branch reads the copy of the variable in the writer.
+template<class type>
+TBranch* EMCalRunAction::AddBranch( const char  *name,
+				    type        *address,
+				    const char  *leaves,
+				    size_t       n,
+				    const G4int *count ) {
+  if ( fWriter )
+    return fOutputTree -> Branch( name, fWriter -> Bind( address, sizeof( type ), n, count ),
+				  leaves );
+  else
+    return fOutputTree -> Branch( name, address, leaves );
+}
+
 //_______________________________________________________________________________
 // Functions to be called when the run starts
-void EMCalRunAction::BeginOfRunAction( const G4Run* ) { 
+void EMCalRunAction::BeginOfRunAction( const G4Run *run ) { 
+
+  // Informs the runManager to save random number seed
+  G4RunManager::GetRunManager() -> SetRandomNumberStore( false );
+
+  // The master sets the seed of the run, from which the seed of each event is
+  // computed, so the events do not depend on the thread where they are processed. If
+  // no seed is given, it is taken from its random engine.
+  if ( fRunManagerType != G4RunManager::workerRM ) {
+    fRunSeed       = fSeed > 0 ? fSeed : 1 + G4long( G4UniformRand()*2147483646. );
+    fRunFirstEvent = fFirstEvent;
+    G4cout << " Seed of the run: " << fRunSeed << G4endl;
 
-  // Creates a new tree
+    // The checkpoint of a resumed run is kept, since it refers to all its events
+    if ( fCheckpoint && fPendingEvents.empty() )
+      this -> WriteCheckpoint( run -> GetNumberOfEventToBeProcessed() );
+
+    // The counters of the progress meter are created before the workers start
+    fProgressMeter -> StartRun( run -> GetNumberOfEventToBeProcessed(),
+				G4RunManager::GetRunManager() -> GetNumberOfThreads() );
+  }
+
+  const EMCalDetectorConstruction *detector =
+    static_cast<const EMCalDetectorConstruction*>
+    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+
+  // The shower profiles are filled by each thread and added at the end of the run,
+  // so they are also configured in the run of the master
+  if ( fProfileBins > 0 )
+    fRun -> EnableProfiles( fProfileBins );
+
+  // The events passing the selection are saved by each thread and merged at the end
+  // of the run
+  if ( !fSelectionFile.empty() )
+    fRun -> EnableSelection( fSelectLeakage, fSelectModules );
+
+  // In multithreaded mode the master does not process events. The files written by
+  // the workers are merged at the end of the run, unless the output is buffered. In
+  // such case the master creates the merger where the workers send their entries.
+  if ( fRunManagerType == G4RunManager::masterRM ) {
+#ifdef EMCAL_BUFFER_MERGER
+    if ( fBufferedOutput ) {
+      fBufferMerger = new EMCalBufferMerger( fFileName.data(),
+					     fFileCreated ? "UPDATE" : "RECREATE" );
+      fFileCreated  = true;
+    }
+#endif
+    return;
+  }
+
+  // Opens the output file and creates a new tree
+  this -> OpenOutputFile();
   fOutputFile -> cd();
   fOutputTree = new TTree( fTreeName.data(), fTreeName.data(), 0 );
 
   // Gives the path of the output tree to the EMCalRun class
   fRun -> SetOutputTree( fOutputTree );
+  fRun -> SetFlushEntries( fFlushEntries, fWritingBuffer );
 
-  // Creates the structure of the output tree
-  const EMCalDetectorConstruction *detector =
-    static_cast<const EMCalDetectorConstruction*>
-    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+  // Number of modules, and maximum number of sub-cells with energy deposited
+  std::vector<EMCalModule*> marray = detector -> GetModuleArray();
+  size_t nmodules = marray.size();
+  size_t ncells   = nmodules*detector -> GetNsubCells();
+
+  // If the tree is filled by a separate thread, the branches are bound to the copies
+  // of the variables owned by the writer. The steps are written from the simulation
+  // thread to the same file, so in such case the tree is filled directly.
+  if ( fWriterQueue > 0 ) {
+    if ( fRecordSteps )
+      G4cout << "WARNING: The writer queue set by /EMCal/run/setWriterQueue is ignored "
+	     << "when the steps are recorded. The output tree is written directly." << G4endl;
+    else
+      fWriter = new EMCalOutputWriter( fWriterQueue );
+  }
+
+  // The number of the event is saved, since the order of the events is lost when the
+  // files of the workers are merged
+  this -> AddBranch( "EventNumber", fRun -> EventNumberPath(), "EventNumber/I" );
+
+  // If the Birks constant is set, the tables of the visible energy are built. The
+  // physics tables already exist at this point.
+  if ( detector -> GetBirksConstant() > 0 )
+    fRun -> EnableQuenching( detector -> GetDetector( 0 ) -> GetMaterial(),
+			     detector -> GetBirksConstant() );
 
   // Sets the branches for the variables of the complete detector.
   if ( detector -> SGVenabled() ) {
-    fOutputTree -> Branch( "DetectorEnergy", fRun -> DetectorEnergyPath(), "DetectorEnergy/D" );
-    fOutputTree -> Branch( "SGVolumeEnergy", fRun -> SGVolumeEnergyPath(), "SGVolumeEnergy/D" );
-    fOutputTree -> Branch( "LostEnergy"    , fRun -> LostEnergyPath()    , "LostEnergy/D"     );
-    fOutputTree -> Branch( "TrueEnergy"    , fRun -> TrueEnergyPath()    , "TrueEnergy/D"     );
-    fOutputTree -> Branch( "nDetHits"      , fRun -> nDetHitsPath()      , "nDetHits/I"       );
-    fOutputTree -> Branch( "nSgvHits"      , fRun -> nSgvHitsPath()      , "nSgvHits/I"       );
+    this -> AddBranch( "DetectorEnergy", fRun -> DetectorEnergyPath(), "DetectorEnergy/D" );
+    this -> AddBranch( "SGVolumeEnergy", fRun -> SGVolumeEnergyPath(), "SGVolumeEnergy/D" );
+    this -> AddBranch( "LostEnergy"    , fRun -> LostEnergyPath()    , "LostEnergy/D"     );
+    this -> AddBranch( "TrueEnergy"    , fRun -> TrueEnergyPath()    , "TrueEnergy/D"     );
+    this -> AddBranch( "nDetHits"      , fRun -> nDetHitsPath()      , "nDetHits/I"       );
+    this -> AddBranch( "nSgvHits"      , fRun -> nSgvHitsPath()      , "nSgvHits/I"       );
   }
   else {
-    fOutputTree -> Branch( "DetectorEnergy", fRun -> DetectorEnergyPath(), "DetectorEnergy/D" );
-    fOutputTree -> Branch( "LostEnergy"    , fRun -> LostEnergyPath()    , "LostEnergy/D"     );
-    fOutputTree -> Branch( "TrueEnergy"    , fRun -> TrueEnergyPath()    , "TrueEnergy/D"     );
-    fOutputTree -> Branch( "nDetHits"      , fRun -> nDetHitsPath()      , "nDetHits/I"       );
+    this -> AddBranch( "DetectorEnergy", fRun -> DetectorEnergyPath(), "DetectorEnergy/D" );
+    this -> AddBranch( "LostEnergy"    , fRun -> LostEnergyPath()    , "LostEnergy/D"     );
+    this -> AddBranch( "TrueEnergy"    , fRun -> TrueEnergyPath()    , "TrueEnergy/D"     );
+    this -> AddBranch( "nDetHits"      , fRun -> nDetHitsPath()      , "nDetHits/I"       );
+  }
+
+  // If the energy is binned in time, the energies inside and outside the gate are
+  // written for the calorimeter and for the modules with energy deposited
+  if ( fTimeBinWidth > 0 ) {
+    fRun -> EnablePulses( fTimeBinWidth, fGateStart, fGateLength );
+    this -> AddBranch( "GateEnergy"     , fRun -> GateEnergyPath()     , "GateEnergy/D"      );
+    this -> AddBranch( "OutOfGateEnergy", fRun -> OutOfGateEnergyPath(), "OutOfGateEnergy/D" );
+    this -> AddBranch( "nPulses"        , fRun -> nPulsesPath()        , "nPulses/I"         );
+    this -> AddBranch( "PulseModule"    , fRun -> PulseModulePath()    ,
+		       "PulseModule[nPulses]/I", nmodules, fRun -> nPulsesPath() );
+    this -> AddBranch( "PulseGateEnergy", fRun -> PulseGateEnergyPath(),
+		       "PulseGateEnergy[nPulses]/D", nmodules, fRun -> nPulsesPath() );
   }
 
+  // The visible energy is only written if it is computed
+  if ( fRun -> QuenchingEnabled() )
+    this -> AddBranch( "QuenchedEnergy", fRun -> QuenchedEnergyPath(), "QuenchedEnergy/D" );
+
+  // The energy of the tracks killed out of the envelope of the modules is only
+  // written if they are killed
+  if ( detector -> KillingEscaping() )
+    this -> AddBranch( "EscapedEnergy", fRun -> EscapedEnergyPath(), "EscapedEnergy/D" );
+
   // Sets the branches for each of the modules. If there is only one module the branches are
   // not created.
-  std::vector<EMCalModule*> marray = detector -> GetModuleArray();
-  if ( marray.size() > 1 )
-    for ( size_t idet = 0; idet < marray.size(); idet++ )
-      fOutputTree -> Branch( ( marray[ idet ] -> GetID() ).data(),
-			     fRun -> GetPathTo( idet ),
-			     fRun -> Title() );
+  if ( nmodules > 1 )
+    for ( size_t idet = 0; idet < nmodules; idet++ )
+      this -> AddBranch( ( marray[ idet ] -> GetID() ).data(),
+			 fRun -> GetPathTo( idet ),
+			 fRun -> Title() );
 
-  // Informs the runManager to save random number seed
-  G4RunManager::GetRunManager() -> SetRandomNumberStore( false );
+  // If the detectors are divided in readout sub-cells, those with energy deposited
+  // are written as arrays
+  if ( fRun -> SegmentationEnabled() ) {
+    this -> AddBranch( "nCells"    , fRun -> nCellsPath()    , "nCells/I"             );
+    this -> AddBranch( "CellModule", fRun -> CellModulePath(), "CellModule[nCells]/I",
+		       ncells, fRun -> nCellsPath() );
+    this -> AddBranch( "CellIndex" , fRun -> CellIndexPath() , "CellIndex[nCells]/I" ,
+		       ncells, fRun -> nCellsPath() );
+    this -> AddBranch( "CellEnergy", fRun -> CellEnergyPath(), "CellEnergy[nCells]/D",
+		       ncells, fRun -> nCellsPath() );
+  }
+
+  // If the steps are recorded they are written to a separate tree, whose entries
+  // correspond to those of the output tree
+  if ( fRecordSteps ) {
+    fStepTree = new TTree( ( fTreeName + "_Steps" ).data(), "Step hits", 0 );
+    fRun -> EnableStepRecording( fStepTree );
+  }
+  else
+    fStepTree = 0;
+
+  // Starts the writer once all the branches are bound
+  if ( fWriter ) {
+    fWriter -> Start( fOutputTree, fFlushEntries, fWritingBuffer );
+    fRun -> SetOutputWriter( fWriter );
+  }
+
+  // Selects the kernels to score and aggregate the energy for the geometry and the
+  // options of this run, so the configuration is not checked again in each step and
+  // event
+  G4bool sgv  = detector -> SGVenabled();
+  G4bool grid = nmodules > 1;
+  fRun -> SelectKernels( sgv, grid );
+  if ( fSteppingAction )
+    fSteppingAction -> SelectKernel( sgv, grid, fRun -> StepOptionsEnabled() );
+
+  // If the energy is scored by the sensitive detectors the stepping action is removed
+  // during the run, so the steps do not need to go through it, unless it kills the
+  // tracks escaping the modules
+  if ( fSteppingAction && !detector -> KillingEscaping() &&
+       detector -> GetScoringMode() == EMCalDetectorConstruction::kSensitiveDetector )
+    G4RunManager::GetRunManager() ->
+      SetUserAction( static_cast<G4UserSteppingAction*>( 0 ) );
 }
 
 //_______________________________________________________________________________
 // Functions to be called when the run ends
 void EMCalRunAction::EndOfRunAction( const G4Run *run ) {
 
-  // Gets the number of the event. If zero it returns.
+  // Gives back the stepping action to the run manager, which owns it
+  if ( fSteppingAction )
+    G4RunManager::GetRunManager() -> SetUserAction( fSteppingAction );
+
   G4int nofEvents = run -> GetNumberOfEvent();
-  if ( nofEvents == 0 ) return;
 
-  G4cout << "  Data saved in file:\t" << fOutputFile -> GetName() << G4endl;
-  G4cout << "  Output tree:       \t" << fOutputTree -> GetName() << G4endl;
-  G4cout << "=================================================="  << G4endl;
+  // The master merges the files of the workers, and adds the shower profiles to the
+  // merged file. At this point all the workers have closed their files.
+  if ( fRunManagerType == G4RunManager::masterRM ) {
+
+    std::vector<G4String> shards;
+
+#ifdef EMCAL_BUFFER_MERGER
+    // Deleting the merger writes the remaining entries and closes the file. If the
+    // run is resumed, the file is merged with those recovered.
+    if ( fBufferMerger ) {
+      delete fBufferMerger;
+      fBufferMerger = 0;
+      if ( fNrecovered > 0 )
+	this -> RecoverOutputFile();
+    }
+    else
+      shards = this -> ShardNames( G4RunManager::GetRunManager() -> GetNumberOfThreads(), 't' );
+#else
+    shards = this -> ShardNames( G4RunManager::GetRunManager() -> GetNumberOfThreads(), 't' );
+#endif
+
+    // The files saved before a run was interrupted are merged with those of the run
+    // that completes it
+    if ( fNrecovered > 0 ) {
+      std::vector<G4String> recovered = this -> ShardNames( fNrecovered, 'r' );
+      shards.insert( shards.end(), recovered.begin(), recovered.end() );
+      fNrecovered = 0;
+    }
+
+    if ( !shards.empty() )
+      this -> MergeShards( shards );
+
+    if ( fCheckpoint && fPendingEvents.empty() )
+      gSystem -> Unlink( this -> CheckpointName().data() );
+
+    if ( nofEvents == 0 ) return;
+
+    TFile *file = TFile::Open( fFileName.data(), "UPDATE" );
+    this -> WriteRunInfo();
+    file -> Close();
+    delete file;
+
+    this -> WriteSelection();
+    this -> WriteSlowEvents();
+
+    G4cout << "  Data saved in file:\t" << fFileName << G4endl;
+    G4cout << "  Output tree:       \t" << fTreeName << G4endl;
+    fRun -> PrintStatistics();
+    fProgressMeter -> PrintStatistics();
+#ifdef G4MULTITHREADED
+    // Balance of the events among the workers
+    const EMCalMTRunManager *runManager =
+      dynamic_cast<const EMCalMTRunManager*>( G4RunManager::GetRunManager() );
+    if ( runManager )
+      runManager -> PrintStatistics();
+#endif
+    G4cout << "=================================================="  << G4endl;
+    return;
+  }
+
+  // Waits until the writer has filled the tree with all the events
+  if ( fWriter )
+    fWriter -> Stop();
+
+  if ( nofEvents > 0 ) {
+
+    // Autosaves the output tree. If the output is buffered, the trees are sent to
+    // the merger when the file is written.
+    if ( !fWritingBuffer ) {
+      fOutputTree -> AutoSave();
+      if ( fStepTree )
+	fStepTree -> AutoSave();
+    }
+
+    // In sequential mode the output is complete, so the shower profiles are written
+    // and the statistics of the run printed
+    if ( fRunManagerType == G4RunManager::sequentialRM ) {
+
+      if ( fCheckpoint && fPendingEvents.empty() )
+	gSystem -> Unlink( this -> CheckpointName().data() );
+
+      fOutputFile -> cd();
+      this -> WriteRunInfo();
+      this -> WriteSelection();
+      this -> WriteSlowEvents();
+
+      G4cout << "  Data saved in file:\t" << fOutputFile -> GetName() << G4endl;
+      G4cout << "  Output tree:       \t" << fOutputTree -> GetName() << G4endl;
+      fRun -> PrintStatistics();
+      fProgressMeter -> PrintStatistics();
+      if ( fWriter )
+	fWriter -> PrintStatistics();
+      G4cout << "=================================================="  << G4endl;
+    }
+    else if ( fWriter )
+      fWriter -> PrintStatistics();
+  }
+
+  if ( fWriter ) {
+    delete fWriter;
+    fWriter = 0;
+  }
 
-  // Autosaves the output tree
-  fOutputTree -> AutoSave();
+  // The workers close their files, so the master can merge them
+  if ( fRunManagerType == G4RunManager::workerRM ) {
+    fOutputFile -> Write();
+#ifdef EMCAL_BUFFER_MERGER
+    if ( fWritingBuffer ) {
+      fMergerFile.reset();
+      fWritingBuffer = false;
+    }
+    else {
+      fOutputFile -> Close();
+      delete fOutputFile;
+    }
+#else
+    fOutputFile -> Close();
+    delete fOutputFile;
+#endif
+    fOutputFile = 0;
+    fOutputTree = 0;
+    fStepTree   = 0;
+  }
 }
 
 //_______________________________________________________________________________
-// Generates a new run, creating a new file if necessary
-G4Run* EMCalRunAction::GenerateRun() {
+// Processes < nevents > events in the processes set by the user. The geometry and
+// the physics tables are built first, and then the processes are forked, so they
+// share them until they are modified. Each process simulates a consecutive range
+// of events with the seed of the run, writing its own file, and the files are
+// merged once all of them have finished. If a process can not be forked or fails,
+// the files are not merged, so those written are kept.
+void EMCalRunAction::ForkBeamOn( G4int nevents ) {
+
+  if ( fRunManagerType != G4RunManager::sequentialRM ) {
+    G4cout << "WARNING: The processes can only be forked in sequential mode" << G4endl;
+    return;
+  }
+
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+
+  // Builds the physics tables without processing events
+  runManager -> BeamOn( 0 );
+
+  // The seed is fixed before forking, so all the processes use the same. The output
+  // file is closed, so the processes do not write to it.
+  G4long seed  = fSeed;
+  G4int  first = fFirstEvent;
+  if ( fSeed == 0 )
+    fSeed = 1 + G4long( G4UniformRand()*2147483646. );
+
+  if ( fOutputFile ) {
+    fOutputFile -> Close();
+    delete fOutputFile;
+    fOutputFile = 0;
+  }
+
+  G4cout << " Forking " << fNprocesses << " processes to simulate " << nevents
+	 << " events with seed " << fSeed << G4endl;
+  std::cout.flush();
+
+  std::vector<pid_t> pids;
+  G4bool             failed = false;
+  for ( G4int iproc = 0; iproc < fNprocesses; iproc++ ) {
+
+    G4int n = nevents/fNprocesses + ( iproc < nevents % fNprocesses ? 1 : 0 );
+
+    pid_t pid = fork();
+
+    if ( pid < 0 ) {
+      G4cout << "WARNING: Unable to fork process " << iproc << G4endl;
+      failed = true;
+      break;
+    }
+
+    // The process runs its events, closes its file and exits without cleaning the
+    // state shared with the parent
+    if ( pid == 0 ) {
+
+      fProcessIndex = iproc;
+      fFileName     = this -> ShardName( iproc, 'p' );
+      fFileCreated  = false;
 
-  // If the file does not exist it is created
-  if ( !fOutputFile )
-    this -> CreateNewFile( "EMCalorimeter_Results.root" );
+      runManager -> BeamOn( n );
+
+      if ( fOutputFile )
+	fOutputFile -> Close();
+
+      std::cout.flush();
+      _exit( 0 );
+    }
+
+    pids.push_back( pid );
+    fFirstEvent += n;
+  }
+
+  // Waits for all the processes
+  for ( size_t iproc = 0; iproc < pids.size(); iproc++ ) {
+
+    G4int status;
+    if ( waitpid( pids[ iproc ], &status, 0 ) < 0 ||
+	 !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+      G4cout << "WARNING: Process " << iproc << " did not finish correctly" << G4endl;
+      failed = true;
+    }
+  }
+
+  std::vector<G4String> shards = this -> ShardNames( pids.size(), 'p' );
+
+  if ( failed ) {
+    G4cout << "WARNING: The files of the processes are not merged. They are kept in:"
+	   << G4endl;
+    for ( size_t ishard = 0; ishard < shards.size(); ishard++ )
+      G4cout << "  " << shards[ ishard ] << G4endl;
+    if ( !fSelectionFile.empty() || !fSlowEventFile.empty() )
+      G4cout << "  The selection and slow event files end with _p<process>" << G4endl;
+    G4cout << "=================================================="  << G4endl;
+  }
+  else {
+
+    this -> MergeShards( shards );
+
+    // The selection and slow event files of the processes are also merged
+    if ( !fSelectionFile.empty() )
+      this -> MergeEventFiles( fSelectionFile, pids.size() );
+    if ( !fSlowEventFile.empty() )
+      this -> MergeEventFiles( fSlowEventFile, pids.size() );
+
+    // The seed is written once the files are merged
+    TFile *file = TFile::Open( fFileName.data(), "UPDATE" );
+    TParameter<Long64_t> runSeed( ( fTreeName + "_RunSeed" ).data(), fSeed );
+    runSeed.Write();
+    file -> Close();
+    delete file;
+
+    G4cout << "  Data saved in file:\t" << fFileName << G4endl;
+    G4cout << "=================================================="  << G4endl;
+  }
+
+  fSeed       = seed;
+  fFirstEvent = first;
+}
+
+//_______________________________________________________________________________
+// Returns the name of the checkpoint of the runs written to the output file
+G4String EMCalRunAction::CheckpointName() const { return fFileName + ".ckpt"; }
+
+//_______________________________________________________________________________
+// Generates a new run
+G4Run* EMCalRunAction::GenerateRun() {
 
   // The EMCalRun class is initiated
   fRun = new EMCalRun;
 
   return fRun;
 }
+
+//_______________________________________________________________________________
+// Returns the number of the event with identifier < eventID > in the current run. If
+// an interrupted run is resumed, only the events which were not saved are simulated,
+// and if the selected events are replayed, only those are simulated.
+G4int EMCalRunAction::GetEventNumber( G4int eventID ) {
+  return fPendingEvents.empty() ? fRunFirstEvent + eventID : fPendingEvents[ eventID ];
+}
+
+//_______________________________________________________________________________
+// Returns the number of the first event of the current run
+G4int EMCalRunAction::GetFirstEvent() { return fRunFirstEvent; }
+
+//_______________________________________________________________________________
+// Returns the seed of the current run
+G4long EMCalRunAction::GetRunSeed() { return fRunSeed; }
+
+//_______________________________________________________________________________
+// Merges the files of events written by the forked processes, adding to < name >
+// the suffix < _p > and the index of the process, in the file < name >. It has the
+// seed line of the first one, and the lines of the events of all of them sorted by
+// the event number. The files of the processes are removed.
+void EMCalRunAction::MergeEventFiles( const G4String &name, size_t nparts ) const {
+
+  G4String header;
+  std::vector< std::pair<G4int, std::string> > events;
+  std::vector<G4String> parts;
+
+  for ( size_t ipart = 0; ipart < nparts; ipart++ ) {
+
+    std::stringstream partName;
+    partName << name << "_p" << ipart;
+
+    std::ifstream part( partName.str().data() );
+    if ( !part ) {
+      G4cout << "WARNING: Unable to read the file <" << partName.str() << ">" << G4endl;
+      continue;
+    }
+    parts.push_back( partName.str() );
+
+    std::string line;
+    while ( std::getline( part, line ) ) {
+
+      if ( line.empty() )
+	continue;
+
+      if ( line.compare( 0, 5, "seed " ) == 0 ) {
+	if ( header.empty() )
+	  header = line;
+	continue;
+      }
+
+      events.push_back( std::make_pair( std::atoi( line.data() ), line ) );
+    }
+  }
+
+  std::stable_sort( events.begin(), events.end() );
+
+  std::ofstream file( name.data() );
+  if ( !header.empty() )
+    file << header << std::endl;
+  for ( size_t ievt = 0; ievt < events.size(); ievt++ )
+    file << events[ ievt ].second << std::endl;
+
+  if ( !file ) {
+    G4cout << "WARNING: Unable to write the file <" << name
+	   << ">. The files of the processes are kept." << G4endl;
+    return;
+  }
+
+  for ( size_t ipart = 0; ipart < parts.size(); ipart++ )
+    gSystem -> Unlink( parts[ ipart ].data() );
+}
+
+//_______________________________________________________________________________
+// Merges the given files, written by the worker threads, the forked processes or
+// recovered from an interrupted run, in the output file, and removes them. The
+// first run written to a file creates it, and the next ones are added to it.
+void EMCalRunAction::MergeShards( const std::vector<G4String> &shards ) {
+
+  TFileMerger merger( false );
+  merger.OutputFile( fFileName.data(), fFileCreated ? "UPDATE" : "RECREATE" );
+
+  for ( size_t ishard = 0; ishard < shards.size(); ishard++ )
+    merger.AddFile( shards[ ishard ].data(), false );
+
+  if ( !merger.Merge() ) {
+    G4cout << "WARNING: Unable to merge the files of the workers in <"
+	   << fFileName << ">. They are kept." << G4endl;
+    return;
+  }
+
+  for ( size_t ishard = 0; ishard < shards.size(); ishard++ )
+    gSystem -> Unlink( shards[ ishard ].data() );
+
+  fFileCreated = true;
+}
+
+//_______________________________________________________________________________
+// Opens the file of this thread if it is not open. In sequential mode it is the
+// output file, which is kept open for the next runs. The workers write to their own
+// file, which is created in each run.
+void EMCalRunAction::OpenOutputFile() {
+
+  if ( fOutputFile )
+    return;
+
+  if ( fRunManagerType == G4RunManager::workerRM ) {
+#ifdef EMCAL_BUFFER_MERGER
+    if ( fBufferMerger ) {
+      fMergerFile    = fBufferMerger -> GetFile();
+      fOutputFile    = fMergerFile.get();
+      fWritingBuffer = true;
+      return;
+    }
+#endif
+    fOutputFile = TFile::Open( this -> ShardName( G4Threading::G4GetThreadId(), 't' ).data(),
+			       "RECREATE" );
+    return;
+  }
+
+  fOutputFile  = TFile::Open( fFileName.data(), fFileCreated ? "UPDATE" : "RECREATE" );
+  fFileCreated = true;
+
+  G4cout << " Created new file with name <" << fFileName << ">" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Marks as done the events saved in the tree < tree > of the file < name >. The
+// number of the first event of the run is < first >.
+static void ReadEventNumbers( const G4String      &name,
+			      const G4String      &tree,
+			      G4int                first,
+			      std::vector<G4bool> &done ) {
+
+  TFile *file = TFile::Open( name.data(), "READ" );
+  if ( !file || file -> IsZombie() ) {
+    G4cout << "WARNING: Unable to read the file <" << name << ">" << G4endl;
+    delete file;
+    return;
+  }
+
+  TTree *events = 0;
+  file -> GetObject( tree.data(), events );
+
+  if ( events ) {
+
+    G4int evtNb;
+    events -> SetBranchStatus( "*", 0 );
+    events -> SetBranchStatus( "EventNumber", 1 );
+    events -> SetBranchAddress( "EventNumber", &evtNb );
+
+    for ( Long64_t ientry = 0; ientry < events -> GetEntries(); ientry++ ) {
+      events -> GetEntry( ientry );
+      if ( evtNb >= first && evtNb - first < G4int( done.size() ) )
+	done[ evtNb - first ] = true;
+    }
+  }
+
+  file -> Close();
+  delete file;
+}
+
+//_______________________________________________________________________________
+// Moves the output file to the files recovered from an interrupted run, so it is
+// merged with them. The output file is created again.
+void EMCalRunAction::RecoverOutputFile() {
+
+  gSystem -> Rename( fFileName.data(), this -> ShardName( fNrecovered++, 'r' ).data() );
+
+  fFileCreated = false;
+}
+
+//_______________________________________________________________________________
+// Simulates again the events written to the selection file < name > by a previous
+// run, with the same seed. Each event is identical to that of the first run, so
+// the detail of the output can be increased ( recording the steps, segmenting the
+// detectors, ... ) only for the selected events.
+void EMCalRunAction::Replay( G4String name ) {
+
+  std::ifstream selection( name.data() );
+  if ( !selection ) {
+    G4cout << "WARNING: Unable to read the selection file <" << name << ">" << G4endl;
+    return;
+  }
+
+  std::string key;
+  G4long      seed = 0;
+  selection >> key >> seed;
+  if ( key != "seed" ) {
+    G4cout << "WARNING: The file <" << name << "> is not a selection file" << G4endl;
+    return;
+  }
+
+  // Each line contains the number of the event and its two seeds, which are
+  // computed again from the seed of the run. The rest of the line is ignored, so the
+  // files of slow events can also be read.
+  G4int evtNb;
+  long  seeds[ 2 ];
+  fPendingEvents.clear();
+  while ( selection >> evtNb >> seeds[ 0 ] >> seeds[ 1 ] ) {
+    fPendingEvents.push_back( evtNb );
+    selection.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
+  }
+
+  if ( fPendingEvents.empty() ) {
+    G4cout << "WARNING: No events found in the selection file <" << name << ">" << G4endl;
+    return;
+  }
+
+  std::sort( fPendingEvents.begin(), fPendingEvents.end() );
+
+  G4cout << " Replaying " << fPendingEvents.size() << " events with seed " << seed << G4endl;
+
+  G4long previousSeed = fSeed;
+  fSeed = seed;
+
+  G4RunManager::GetRunManager() -> BeamOn( G4int( fPendingEvents.size() ) );
+
+  fPendingEvents.clear();
+  fSeed = previousSeed;
+}
+
+//_______________________________________________________________________________
+// Resumes the run written to the checkpoint of the output file. The events saved
+// to the files of the interrupted run are recovered, and only the rest are
+// simulated. Since the seed of each event is computed from that of the run and its
+// number, the output is the same as if the run had not been interrupted, although
+// the order of the entries may differ. The shower profiles and the statistics only
+// include the events simulated after resuming.
+void EMCalRunAction::Resume() {
+
+  std::ifstream checkpoint( this -> CheckpointName().data() );
+  if ( !checkpoint ) {
+    G4cout << "WARNING: No checkpoint found for the file <" << fFileName << ">" << G4endl;
+    return;
+  }
+
+  G4long      seed    = 0;
+  G4int       first   = 0;
+  G4int       nevents = 0;
+  G4int       inFile  = 0;
+  std::string tree;
+  std::string key;
+  while ( checkpoint >> key ) {
+    if      ( key == "seed" )
+      checkpoint >> seed;
+    else if ( key == "first" )
+      checkpoint >> first;
+    else if ( key == "events" )
+      checkpoint >> nevents;
+    else if ( key == "infile" )
+      checkpoint >> inFile;
+    else if ( key == "tree" )
+      checkpoint >> tree;
+  }
+  checkpoint.close();
+
+  if ( tree != fTreeName ) {
+    G4cout << "WARNING: The checkpoint refers to the tree <" << tree
+	   << ">. The run is not resumed." << G4endl;
+    return;
+  }
+
+  if ( fOutputFile ) {
+    fOutputFile -> Close();
+    delete fOutputFile;
+    fOutputFile = 0;
+  }
+
+  // The files recovered by previous attempts are kept. In sequential mode, or if the
+  // output is buffered, the entries were saved to the output file itself, and
+  // otherwise to the files of the worker threads.
+  fNrecovered = 0;
+  while ( !gSystem -> AccessPathName( this -> ShardName( fNrecovered, 'r' ).data() ) )
+    fNrecovered++;
+
+  if ( inFile && !gSystem -> AccessPathName( fFileName.data() ) )
+    this -> RecoverOutputFile();
+
+  for ( G4int ishard = 0; ishard < kMaxShards; ishard++ ) {
+    G4String name = this -> ShardName( ishard, 't' );
+    if ( !gSystem -> AccessPathName( name.data() ) )
+      gSystem -> Rename( name.data(), this -> ShardName( fNrecovered++, 'r' ).data() );
+  }
+
+  fFileCreated = !gSystem -> AccessPathName( fFileName.data() );
+
+  // Looks for the events which were not saved
+  std::vector<G4bool> done( nevents, false );
+  for ( G4int ifile = 0; ifile < fNrecovered; ifile++ )
+    ReadEventNumbers( this -> ShardName( ifile, 'r' ), tree, first, done );
+
+  fPendingEvents.clear();
+  for ( G4int ievt = 0; ievt < nevents; ievt++ )
+    if ( !done[ ievt ] )
+      fPendingEvents.push_back( first + ievt );
+
+  G4cout << " Resuming run with seed " << seed << ": " << nevents - fPendingEvents.size()
+	 << " of " << nevents << " events recovered from " << fNrecovered << " files" << G4endl;
+
+  G4long previousSeed  = fSeed;
+  G4int  previousFirst = fFirstEvent;
+  fSeed       = seed;
+  fFirstEvent = first;
+
+  if ( !fPendingEvents.empty() ) {
+
+    G4RunManager::GetRunManager() -> BeamOn( G4int( fPendingEvents.size() ) );
+
+    // In sequential mode the output file is merged with those recovered. In
+    // multithreaded mode this is done by the master at the end of the run.
+    if ( fRunManagerType == G4RunManager::sequentialRM ) {
+      fOutputFile -> Close();
+      delete fOutputFile;
+      fOutputFile = 0;
+      this -> RecoverOutputFile();
+    }
+  }
+
+  if ( fNrecovered > 0 ) {
+
+    this -> MergeShards( this -> ShardNames( fNrecovered, 'r' ) );
+    fNrecovered = 0;
+
+    // If all the events had been saved no run is processed, so the seed is written
+    // once the files are merged
+    if ( fPendingEvents.empty() ) {
+      TFile *file = TFile::Open( fFileName.data(), "UPDATE" );
+      TParameter<Long64_t> runSeed( ( fTreeName + "_RunSeed" ).data(), seed );
+      runSeed.Write();
+      file -> Close();
+      delete file;
+    }
+  }
+
+  gSystem -> Unlink( this -> CheckpointName().data() );
+
+  fPendingEvents.clear();
+  fSeed       = previousSeed;
+  fFirstEvent = previousFirst;
+
+  G4cout << "  Data saved in file:\t" << fFileName << G4endl;
+  G4cout << "=================================================="  << G4endl;
+}
+
+//_______________________________________________________________________________
+// Sets the name of the output file. The file is created at the beginning of the
+// next run.
+void EMCalRunAction::SetOutputFileName( G4String name ) {
+
+  if ( fOutputFile ) {
+    fOutputFile -> Close();
+    delete fOutputFile;
+    fOutputFile = 0;
+  }
+
+  fFileName    = name;
+  fFileCreated = false;
+
+  G4cout << " Output file name changed to <" << name << ">" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Sets the way the workers write the output. With < shards > each worker writes its
+// own file, merged at the end of the run. With < buffer > all the workers send their
+// entries to the output file while the run is processed.
+void EMCalRunAction::SetOutputMode( G4String mode ) {
+
+#ifndef EMCAL_BUFFER_MERGER
+  if ( mode == "buffer" ) {
+    G4cout << "WARNING: The buffered output requires Root 6.10 or later. "
+	   << "The output mode is not changed." << G4endl;
+    return;
+  }
+#endif
+
+  fBufferedOutput = ( mode == "buffer" );
+
+  G4cout << " Output mode set to <" << mode << ">" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Sets the interval between the reports of the progress of the runs. The meter only
+// exists in the master or sequential run manager.
+void EMCalRunAction::SetProgressInterval( G4double interval ) {
+
+  if ( fProgressMeter )
+    fProgressMeter -> SetInterval( interval );
+}
+
+//_______________________________________________________________________________
+// Returns the name of the file written by the worker thread ( < kind > = t ) or
+// process ( < kind > = p ), or recovered from an interrupted run ( < kind > = r ),
+// with number < index >
+G4String EMCalRunAction::ShardName( G4int index, char kind ) const {
+
+  G4String base = fFileName;
+  if ( base.size() > 5 && base.substr( base.size() - 5 ) == ".root" )
+    base = base.substr( 0, base.size() - 5 );
+
+  std::stringstream name;
+  name << base << "_" << kind << index << ".root";
+
+  return name.str();
+}
+
+//_______________________________________________________________________________
+// Returns the names of the files of kind < kind > with number below < nshards >
+// which exist
+std::vector<G4String> EMCalRunAction::ShardNames( G4int nshards, char kind ) const {
+
+  std::vector<G4String> shards;
+  for ( G4int ishard = 0; ishard < nshards; ishard++ ) {
+
+    G4String name = this -> ShardName( ishard, kind );
+
+    // The function returns false if the file exists
+    if ( !gSystem -> AccessPathName( name.data() ) )
+      shards.push_back( name );
+  }
+
+  return shards;
+}
+
+//_______________________________________________________________________________
+// Writes the checkpoint of a run of < nevents > events, with the information needed
+// to resume it. The events already simulated are those saved to the output files,
+// whose trees are saved every < fFlushEntries > entries.
+void EMCalRunAction::WriteCheckpoint( G4int nevents ) const {
+
+  std::ofstream checkpoint( this -> CheckpointName().data() );
+
+  checkpoint << "seed "   << fRunSeed       << std::endl;
+  checkpoint << "first "  << fRunFirstEvent << std::endl;
+  checkpoint << "events " << nevents        << std::endl;
+  checkpoint << "tree "   << fTreeName      << std::endl;
+  checkpoint << "infile " << ( fRunManagerType == G4RunManager::sequentialRM ||
+			      fBufferedOutput ) << std::endl;
+
+  if ( !checkpoint )
+    G4cout << "WARNING: Unable to write the checkpoint <" << this -> CheckpointName()
+	   << ">" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Writes the numbers of the events selected in the run to the selection file,
+// with the seed of the run and the seeds of each event. The forked processes add
+// their index to the name of the file.
+void EMCalRunAction::WriteSelection() const {
+
+  if ( fSelectionFile.empty() )
+    return;
+
+  std::stringstream name;
+  name << fSelectionFile;
+  if ( fProcessIndex >= 0 )
+    name << "_p" << fProcessIndex;
+
+  std::vector<G4int> events = fRun -> GetSelectedEvents();
+  std::sort( events.begin(), events.end() );
+
+  std::ofstream selection( name.str().data() );
+
+  selection << "seed " << fRunSeed << std::endl;
+
+  long seeds[ 2 ];
+  for ( size_t ievt = 0; ievt < events.size(); ievt++ ) {
+    EMCalPrimaryGeneratorAction::GetEventSeeds( fRunSeed, events[ ievt ], seeds );
+    selection << events[ ievt ] << " " << seeds[ 0 ] << " " << seeds[ 1 ] << std::endl;
+  }
+
+  if ( !selection )
+    G4cout << "WARNING: Unable to write the selection file <" << name.str() << ">" << G4endl;
+  else
+    G4cout << "  Selected events:   \t" << events.size() << " ( written to <"
+	   << name.str() << "> )" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Writes the events which took more time than the threshold to the slow event file,
+// with the same format as the selection file followed by the wall and CPU time in
+// seconds, the energy of the primary particle in MeV and its direction. The forked
+// processes add their index to the name of the file.
+void EMCalRunAction::WriteSlowEvents() const {
+
+  if ( fSlowEventFile.empty() )
+    return;
+
+  std::stringstream name;
+  name << fSlowEventFile;
+  if ( fProcessIndex >= 0 )
+    name << "_p" << fProcessIndex;
+
+  const std::vector<EMCalRun::SlowEvent> &events = fRun -> GetSlowEvents();
+
+  std::ofstream file( name.str().data() );
+
+  file << "seed " << fRunSeed << std::endl;
+
+  long seeds[ 2 ];
+  for ( size_t ievt = 0; ievt < events.size(); ievt++ ) {
+
+    const EMCalRun::SlowEvent &event = events[ ievt ];
+
+    EMCalPrimaryGeneratorAction::GetEventSeeds( fRunSeed, event.Number, seeds );
+
+    file << event.Number << " " << seeds[ 0 ] << " " << seeds[ 1 ] << " "
+	 << event.WallTime << " " << event.CpuTime << " " << event.Energy/MeV << " "
+	 << event.Direction.x() << " " << event.Direction.y() << " "
+	 << event.Direction.z() << std::endl;
+  }
+
+  if ( !file )
+    G4cout << "WARNING: Unable to write the slow event file <" << name.str() << ">" << G4endl;
+  else
+    G4cout << "  Slow event file:   \t" << name.str() << G4endl;
+}
+
+//_______________________________________________________________________________
+// Writes the seed of the run and the shower profiles to the current directory. The
+// name of the seed is that of the output tree followed by < _RunSeed >.
+void EMCalRunAction::WriteRunInfo() const {
+
+  // The forked processes do not write the seed, since it would be added when
+  // merging their files
+  if ( fProcessIndex < 0 ) {
+    TParameter<Long64_t> seed( ( fTreeName + "_RunSeed" ).data(), fRunSeed );
+    seed.Write();
+  }
+
+  if ( fRun -> FillingProfiles() )
+    fRun -> WriteProfiles();
+}
@@ -31,16 +31,208 @@ EMCalRunActionMessenger::EMCalRunActionMessenger( EMCalRunAction *run ) :
   fOutputFileNameCmd
     = new G4UIcmdWithAString( "/EMCal/run/setFileName", this );
   fOutputFileNameCmd -> SetGuidance( "Select the output file name" );
+  fOutputFileNameCmd -> SetGuidance( "In multithreaded mode each worker writes to <name>_t<id>.root," );
+  fOutputFileNameCmd -> SetGuidance( "and the files are merged in <name> at the end of the run." );
   fOutputFileNameCmd -> SetParameterName( "OutputFileName", false );
   fOutputFileNameCmd -> SetDefaultValue( "EMCalorimeter_Results.root" );
   fOutputFileNameCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
 
+  fOutputModeCmd
+    = new G4UIcmdWithAString( "/EMCal/run/setOutputMode", this );
+  fOutputModeCmd -> SetGuidance( "Way the worker threads write the output file. With" );
+  fOutputModeCmd -> SetGuidance( "<shards> each worker writes its own file, merged at the end" );
+  fOutputModeCmd -> SetGuidance( "of the run. With <buffer> the entries are sent to the output" );
+  fOutputModeCmd -> SetGuidance( "file while the run is processed." );
+  fOutputModeCmd -> SetParameterName( "OutputMode", false );
+  fOutputModeCmd -> SetCandidates( "shards buffer" );
+  fOutputModeCmd -> SetDefaultValue( "shards" );
+  fOutputModeCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fFlushEntriesCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setFlushEntries", this );
+  fFlushEntriesCmd -> SetGuidance( "Number of entries after which the output trees are saved." );
+  fFlushEntriesCmd -> SetGuidance( "With buffered output, the entries are sent to be merged." );
+  fFlushEntriesCmd -> SetGuidance( "If zero they are only saved at the end of the run." );
+  fFlushEntriesCmd -> SetParameterName( "FlushEntries", false );
+  fFlushEntriesCmd -> SetDefaultValue( 100000 );
+  fFlushEntriesCmd -> SetRange( "FlushEntries >= 0" );
+  fFlushEntriesCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fWriterQueueCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setWriterQueue", this );
+  fWriterQueueCmd -> SetGuidance( "Number of events in the queue of the thread filling the" );
+  fWriterQueueCmd -> SetGuidance( "output tree. If zero the tree is filled by the simulation." );
+  fWriterQueueCmd -> SetParameterName( "WriterQueue", false );
+  fWriterQueueCmd -> SetDefaultValue( 0 );
+  fWriterQueueCmd -> SetRange( "WriterQueue >= 0" );
+  fWriterQueueCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSeedCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setSeed", this );
+  fSeedCmd -> SetGuidance( "Seed of the next runs. The random engine is seeded at the" );
+  fSeedCmd -> SetGuidance( "beginning of each event from it and the number of the event," );
+  fSeedCmd -> SetGuidance( "so the results do not depend on the number of threads. If" );
+  fSeedCmd -> SetGuidance( "zero, the seed of each run is taken from the random engine." );
+  fSeedCmd -> SetParameterName( "Seed", false );
+  fSeedCmd -> SetDefaultValue( 0 );
+  fSeedCmd -> SetRange( "Seed >= 0" );
+  fSeedCmd -> SetToBeBroadcasted( false );
+  fSeedCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fFirstEventCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setFirstEvent", this );
+  fFirstEventCmd -> SetGuidance( "Number of the first event of the next runs. Together with" );
+  fFirstEventCmd -> SetGuidance( "the seed, it allows to simulate again any event." );
+  fFirstEventCmd -> SetParameterName( "FirstEvent", false );
+  fFirstEventCmd -> SetDefaultValue( 0 );
+  fFirstEventCmd -> SetRange( "FirstEvent >= 0" );
+  fFirstEventCmd -> SetToBeBroadcasted( false );
+  fFirstEventCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fProcessesCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setProcesses", this );
+  fProcessesCmd -> SetGuidance( "Number of processes forked by /EMCal/run/forkBeamOn" );
+  fProcessesCmd -> SetParameterName( "Processes", false );
+  fProcessesCmd -> SetDefaultValue( 1 );
+  fProcessesCmd -> SetRange( "Processes > 0" );
+  fProcessesCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fForkBeamOnCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/forkBeamOn", this );
+  fForkBeamOnCmd -> SetGuidance( "Simulates the given number of events in separate processes," );
+  fForkBeamOnCmd -> SetGuidance( "forked once the geometry and the physics are built. Each" );
+  fForkBeamOnCmd -> SetGuidance( "process writes its own file, and they are merged at the end." );
+  fForkBeamOnCmd -> SetGuidance( "Only available in sequential mode." );
+  fForkBeamOnCmd -> SetParameterName( "Events", false );
+  fForkBeamOnCmd -> SetRange( "Events >= 0" );
+  fForkBeamOnCmd -> SetToBeBroadcasted( false );
+  fForkBeamOnCmd -> AvailableForStates( G4State_Idle );
+
+  fCheckpointCmd
+    = new G4UIcmdWithABool( "/EMCal/run/setCheckpoint", this );
+  fCheckpointCmd -> SetGuidance( "Write a checkpoint at the beginning of each run, removed" );
+  fCheckpointCmd -> SetGuidance( "when it ends, so an interrupted run can be resumed with" );
+  fCheckpointCmd -> SetGuidance( "/EMCal/run/resume. The events saved every <FlushEntries>" );
+  fCheckpointCmd -> SetGuidance( "entries are recovered." );
+  fCheckpointCmd -> SetParameterName( "Checkpoint", true );
+  fCheckpointCmd -> SetDefaultValue( true );
+  fCheckpointCmd -> SetToBeBroadcasted( false );
+  fCheckpointCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fResumeCmd
+    = new G4UIcmdWithoutParameter( "/EMCal/run/resume", this );
+  fResumeCmd -> SetGuidance( "Resumes the run interrupted while writing the output file." );
+  fResumeCmd -> SetGuidance( "Only the events which were not saved are simulated, with the" );
+  fResumeCmd -> SetGuidance( "seed of the run, and the files are merged. The configuration" );
+  fResumeCmd -> SetGuidance( "must be the same as in the interrupted run." );
+  fResumeCmd -> SetToBeBroadcasted( false );
+  fResumeCmd -> AvailableForStates( G4State_Idle );
+
+  fSelectionFileCmd
+    = new G4UIcmdWithAString( "/EMCal/run/setSelectionFile", this );
+  fSelectionFileCmd -> SetGuidance( "File where the numbers and seeds of the events passing the" );
+  fSelectionFileCmd -> SetGuidance( "selection are written at the end of each run, to be simulated" );
+  fSelectionFileCmd -> SetGuidance( "again with /EMCal/run/replay. If empty no events are selected." );
+  fSelectionFileCmd -> SetParameterName( "SelectionFile", true );
+  fSelectionFileCmd -> SetDefaultValue( "" );
+  fSelectionFileCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSlowEventFileCmd
+    = new G4UIcmdWithAString( "/EMCal/run/setSlowEventFile", this );
+  fSlowEventFileCmd -> SetGuidance( "File where the events taking more time than the threshold set" );
+  fSlowEventFileCmd -> SetGuidance( "in /EMCal/event/ are written at the end of each run, with their" );
+  fSlowEventFileCmd -> SetGuidance( "seeds, times, energy and direction. They can be simulated again" );
+  fSlowEventFileCmd -> SetGuidance( "with /EMCal/run/replay. If empty the events are not written." );
+  fSlowEventFileCmd -> SetParameterName( "SlowEventFile", true );
+  fSlowEventFileCmd -> SetDefaultValue( "" );
+  fSlowEventFileCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fProgressIntervalCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/run/setProgressInterval", this );
+  fProgressIntervalCmd -> SetGuidance( "Time between the reports of the events and steps processed per" );
+  fProgressIntervalCmd -> SetGuidance( "second by all the threads, and of the time expected to finish" );
+  fProgressIntervalCmd -> SetGuidance( "the run. If zero the progress is not reported." );
+  fProgressIntervalCmd -> SetParameterName( "ProgressInterval", false );
+  fProgressIntervalCmd -> SetRange( "ProgressInterval >= 0" );
+  fProgressIntervalCmd -> SetUnitCategory( "Time" );
+  fProgressIntervalCmd -> SetToBeBroadcasted( false );
+  fProgressIntervalCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSelectLeakageCmd
+    = new G4UIcmdWithADouble( "/EMCal/run/setSelectLeakage", this );
+  fSelectLeakageCmd -> SetGuidance( "Minimum fraction of the energy of the primary particle lost" );
+  fSelectLeakageCmd -> SetGuidance( "by the calorimeter for an event to be selected. If zero the" );
+  fSelectLeakageCmd -> SetGuidance( "criterion is not applied." );
+  fSelectLeakageCmd -> SetParameterName( "SelectLeakage", false );
+  fSelectLeakageCmd -> SetDefaultValue( 0 );
+  fSelectLeakageCmd -> SetRange( "SelectLeakage >= 0 && SelectLeakage <= 1" );
+  fSelectLeakageCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fSelectModulesCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setSelectModules", this );
+  fSelectModulesCmd -> SetGuidance( "Minimum number of detectors with energy deposited for an event" );
+  fSelectModulesCmd -> SetGuidance( "to be selected. If zero the criterion is not applied." );
+  fSelectModulesCmd -> SetParameterName( "SelectModules", false );
+  fSelectModulesCmd -> SetDefaultValue( 0 );
+  fSelectModulesCmd -> SetRange( "SelectModules >= 0" );
+  fSelectModulesCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fReplayCmd
+    = new G4UIcmdWithAString( "/EMCal/run/replay", this );
+  fReplayCmd -> SetGuidance( "Simulates again the events of a selection file, with the same" );
+  fReplayCmd -> SetGuidance( "seeds, and writes them with the current output configuration." );
+  fReplayCmd -> SetParameterName( "SelectionFile", false );
+  fReplayCmd -> SetToBeBroadcasted( false );
+  fReplayCmd -> AvailableForStates( G4State_Idle );
+
   fOutputTreeNameCmd
     = new G4UIcmdWithAString( "/EMCal/run/setTreeName", this );
   fOutputTreeNameCmd -> SetGuidance( "Select the output file name" );
   fOutputTreeNameCmd -> SetParameterName( "OutputTreeName", false );
   fOutputTreeNameCmd -> SetDefaultValue( "DecayTree" );
   fOutputTreeNameCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fProfileBinsCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/run/setProfileBins", this );
+  fProfileBinsCmd -> SetGuidance( "Number of bins of the longitudinal and lateral shower" );
+  fProfileBinsCmd -> SetGuidance( "profiles. If zero the profiles are not filled." );
+  fProfileBinsCmd -> SetParameterName( "ProfileBins", false );
+  fProfileBinsCmd -> SetDefaultValue( 0 );
+  fProfileBinsCmd -> SetRange( "ProfileBins >= 0" );
+  fProfileBinsCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fRecordStepsCmd
+    = new G4UIcmdWithABool( "/EMCal/run/recordSteps", this );
+  fRecordStepsCmd -> SetGuidance( "Write the steps depositing energy in the modules" );
+  fRecordStepsCmd -> SetGuidance( "to a separate tree, to compute again the response" );
+  fRecordStepsCmd -> SetParameterName( "RecordSteps", true );
+  fRecordStepsCmd -> SetDefaultValue( true );
+  fRecordStepsCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fTimeBinWidthCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/run/setTimeBinWidth", this );
+  fTimeBinWidthCmd -> SetGuidance( "Width of the time bins of the pulses of the modules." );
+  fTimeBinWidthCmd -> SetGuidance( "If zero the energy is not binned in time." );
+  fTimeBinWidthCmd -> SetParameterName( "TimeBinWidth", false );
+  fTimeBinWidthCmd -> SetRange( "TimeBinWidth >= 0" );
+  fTimeBinWidthCmd -> SetUnitCategory( "Time" );
+  fTimeBinWidthCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fGateStartCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/run/setGateStart", this );
+  fGateStartCmd -> SetGuidance( "Start of the gate where the pulses are integrated" );
+  fGateStartCmd -> SetParameterName( "GateStart", false );
+  fGateStartCmd -> SetRange( "GateStart >= 0" );
+  fGateStartCmd -> SetUnitCategory( "Time" );
+  fGateStartCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fGateLengthCmd
+    = new G4UIcmdWithADoubleAndUnit( "/EMCal/run/setGateLength", this );
+  fGateLengthCmd -> SetGuidance( "Length of the gate where the pulses are integrated" );
+  fGateLengthCmd -> SetParameterName( "GateLength", false );
+  fGateLengthCmd -> SetRange( "GateLength >= 0" );
+  fGateLengthCmd -> SetUnitCategory( "Time" );
+  fGateLengthCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
 }
 
 //_______________________________________________________________________________
@@ -49,7 +241,27 @@ EMCalRunActionMessenger::~EMCalRunActionMessenger() {
 
   delete fRunDir;
   delete fOutputFileNameCmd;
+  delete fOutputModeCmd;
+  delete fFlushEntriesCmd;
   delete fOutputTreeNameCmd;
+  delete fProfileBinsCmd;
+  delete fRecordStepsCmd;
+  delete fTimeBinWidthCmd;
+  delete fGateStartCmd;
+  delete fGateLengthCmd;
+  delete fWriterQueueCmd;
+  delete fSeedCmd;
+  delete fFirstEventCmd;
+  delete fProcessesCmd;
+  delete fForkBeamOnCmd;
+  delete fCheckpointCmd;
+  delete fResumeCmd;
+  delete fSelectionFileCmd;
+  delete fSlowEventFileCmd;
+  delete fProgressIntervalCmd;
+  delete fSelectLeakageCmd;
+  delete fSelectModulesCmd;
+  delete fReplayCmd;
 }
 
 //_______________________________________________________________________________
@@ -57,7 +269,47 @@ EMCalRunActionMessenger::~EMCalRunActionMessenger() {
 void EMCalRunActionMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
 
   if      ( command == fOutputFileNameCmd )
-    fRunAction -> CreateNewFile( value );
+    fRunAction -> SetOutputFileName( value );
+  else if ( command == fOutputModeCmd )
+    fRunAction -> SetOutputMode( value );
+  else if ( command == fFlushEntriesCmd )
+    fRunAction -> SetFlushEntries( fFlushEntriesCmd -> GetNewIntValue( value ) );
   else if ( command == fOutputTreeNameCmd )
     fRunAction -> SetOutputTreeName( value );
+  else if ( command == fProfileBinsCmd )
+    fRunAction -> SetProfileBins( fProfileBinsCmd -> GetNewIntValue( value ) );
+  else if ( command == fRecordStepsCmd )
+    fRunAction -> SetRecordSteps( fRecordStepsCmd -> GetNewBoolValue( value ) );
+  else if ( command == fTimeBinWidthCmd )
+    fRunAction -> SetTimeBinWidth( fTimeBinWidthCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fGateStartCmd )
+    fRunAction -> SetGateStart( fGateStartCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fGateLengthCmd )
+    fRunAction -> SetGateLength( fGateLengthCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSeedCmd )
+    fRunAction -> SetSeed( fSeedCmd -> GetNewIntValue( value ) );
+  else if ( command == fFirstEventCmd )
+    fRunAction -> SetFirstEvent( fFirstEventCmd -> GetNewIntValue( value ) );
+  else if ( command == fProcessesCmd )
+    fRunAction -> SetProcesses( fProcessesCmd -> GetNewIntValue( value ) );
+  else if ( command == fForkBeamOnCmd )
+    fRunAction -> ForkBeamOn( fForkBeamOnCmd -> GetNewIntValue( value ) );
+  else if ( command == fCheckpointCmd )
+    fRunAction -> SetCheckpoint( fCheckpointCmd -> GetNewBoolValue( value ) );
+  else if ( command == fResumeCmd )
+    fRunAction -> Resume();
+  else if ( command == fSelectionFileCmd )
+    fRunAction -> SetSelectionFile( value );
+  else if ( command == fSlowEventFileCmd )
+    fRunAction -> SetSlowEventFile( value );
+  else if ( command == fProgressIntervalCmd )
+    fRunAction -> SetProgressInterval( fProgressIntervalCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSelectLeakageCmd )
+    fRunAction -> SetSelectLeakage( fSelectLeakageCmd -> GetNewDoubleValue( value ) );
+  else if ( command == fSelectModulesCmd )
+    fRunAction -> SetSelectModules( fSelectModulesCmd -> GetNewIntValue( value ) );
+  else if ( command == fReplayCmd )
+    fRunAction -> Replay( value );
+  else if ( command == fWriterQueueCmd )
+    fRunAction -> SetWriterQueue( fWriterQueueCmd -> GetNewIntValue( value ) );
 }
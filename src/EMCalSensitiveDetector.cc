@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SensitiveDetector class. It is attached to the detector and      //
+//  shower-generator volumes when the scoring is done through sensitive          //
+//  detectors, and creates one hit for each volume with energy deposited in an   //
+//  event.                                                                       //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalSensitiveDetector.hh"
+#include "EMCalDetectorConstruction.hh"
+#include "EMCalRun.hh"
+
+#include "G4HCofThisEvent.hh"
+#include "G4RunManager.hh"
+#include "G4SDManager.hh"
+#include "G4Step.hh"
+
+
+//_______________________________________________________________________________
+// Constructor
+EMCalSensitiveDetector::
+EMCalSensitiveDetector( const G4String                  &name,
+			const EMCalDetectorConstruction *detector ) :
+  G4VSensitiveDetector( name ),
+  fDetector( detector ),
+  fHitsCollection( 0 ),
+  fHitsCollectionID( -1 ),
+  fRun( 0 ) {
+
+  collectionName.insert( "EMCalHitsCollection" );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalSensitiveDetector::~EMCalSensitiveDetector() { }
+
+//_______________________________________________________________________________
+// Resets the position of the hits of the last event. Only the volumes with a hit
+// are visited.
+void EMCalSensitiveDetector::EndOfEvent( G4HCofThisEvent* ) {
+
+  for ( size_t ihit = 0; ihit < fHitsCollection -> entries(); ihit++ ) {
+
+    EMCalHit *hit = ( *fHitsCollection )[ ihit ];
+    fHitIndex[ 2*hit -> GetModule() +
+	       ( hit -> GetType() == EMCalDetectorConstruction::kSGVolume ) ] = -1;
+  }
+}
+
+//_______________________________________________________________________________
+// Creates the hits collection of the new event
+void EMCalSensitiveDetector::Initialize( G4HCofThisEvent *hce ) {
+
+  fHitsCollection = new EMCalHitsCollection( SensitiveDetectorName, collectionName[ 0 ] );
+
+  if ( fHitsCollectionID < 0 )
+    fHitsCollectionID = G4SDManager::GetSDMpointer() ->
+      GetCollectionID( fHitsCollection );
+  hce -> AddHitsCollection( fHitsCollectionID, fHitsCollection );
+
+  // There is one position for the detector and the shower-generator volume of each
+  // module. The geometry might have been updated since the last event.
+  if ( fHitIndex.size() != 2*fDetector -> GetNmodules() )
+    fHitIndex.assign( 2*fDetector -> GetNmodules(), -1 );
+
+  // The run of this thread is cached, for the information obtained from each step
+  // besides the hits
+  fRun = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> GetNonConstCurrentRun() );
+}
+
+//_______________________________________________________________________________
+// Adds the energy deposited in the step to the hit of the volume. The options of the
+// steps enabled in the run are then applied: the energy is added to the pulse of the
+// module, the visible energy is computed, the energy is added to the readout
+// sub-cells, the step is stored and the shower profiles filled. Steps without energy
+// deposited are skipped.
+G4bool EMCalSensitiveDetector::ProcessHits( G4Step *step, G4TouchableHistory* ) {
+
+  G4double edep = step -> GetTotalEnergyDeposit();
+  if ( edep == 0. )
+    return false;
+
+  const EMCalDetectorConstruction::VolumeInfo &info =
+    fDetector -> GetVolumeInfo( step -> GetPreStepPoint() -> GetTouchableHandle()
+				-> GetVolume() -> GetLogicalVolume() );
+
+  G4int &index = fHitIndex[ 2*info.Module +
+			    ( info.Type == EMCalDetectorConstruction::kSGVolume ) ];
+  if ( index < 0 )
+    index = fHitsCollection -> insert( new EMCalHit( info.Module, info.Type ) ) - 1;
+
+  ( *fHitsCollection )[ index ] -> AddEnergy( edep );
+
+  fRun -> ScoreStepOptions( step, info.Module, info.Type );
+
+  return true;
+}
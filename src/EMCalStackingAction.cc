@@ -0,0 +1,288 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the StackingAction class. The tracks created out of the envelope of  //
+//  the modules which can not reach it are killed, if requested. If the events   //
+//  are divided in sub-events, the secondary tracks with energy above the        //
+//  threshold are grouped and sent to the other worker threads instead of being  //
+//  stacked. When the stack of the event is empty, the groups which no other     //
+//  thread has taken are given back to it. The number of tracks in the stack can //
+//  be limited. The tracks above the limit are saved in a compact form, and they //
+//  are stacked again when the stack is empty, the last ones first or the ones   //
+//  with less energy first.                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalDetectorConstruction.hh"
+#include "EMCalRun.hh"
+#include "EMCalRunAction.hh"
+#include "EMCalStackingAction.hh"
+#include "EMCalStackingActionMessenger.hh"
+
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4Positron.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
+
+
+//_______________________________________________________________________________
+// Compares the energies of two saved tracks, so the heap of tracks out of the stack
+// has the one with less energy on top
+static inline G4bool MoreEnergetic( const EMCalSubEvent::Track &first,
+				    const EMCalSubEvent::Track &second ) {
+  return first.Energy > second.Energy;
+}
+
+//_______________________________________________________________________________
+// Compares the indices of two sub-events, so the one created first is at the end
+static inline G4bool LaterSubEvent( const EMCalSubEvent *first,
+				    const EMCalSubEvent *second ) {
+  return first -> GetIndex() > second -> GetIndex();
+}
+
+
+//_______________________________________________________________________________
+// Constructor. The scheduler is only defined by the multithreaded run manager. By
+// default at most a million tracks are saved out of the stack, about a hundred
+// megabytes per thread.
+EMCalStackingAction::EMCalStackingAction() :
+  G4UserStackingAction(),
+  fKillEscaping( false ),
+  fMinEnergy( 0 ),
+  fOffloading( false ),
+  fOwner( G4Threading::G4GetThreadId() ),
+  fSubEvent( 0 ),
+  fSubEventEnergy( 0 ),
+  fEventNumber( 0 ),
+  fNsubEvents( 0 ),
+  fMaxSaved( 1000000 ),
+  fMaxTracks( 0 ),
+  fOrder( kDepth ),
+  fRestoring( false ),
+  fRun( 0 ),
+  fSavedFull( false ) {
+
+  fDetector  = static_cast<const EMCalDetectorConstruction*>
+    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+  fScheduler = EMCalSubEventScheduler::GetInstance();
+  fMessenger = new EMCalStackingActionMessenger( this );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalStackingAction::~EMCalStackingAction() {
+
+  delete fMessenger;
+  delete fSubEvent;
+  this -> ClearReclaimed();
+}
+
+//_______________________________________________________________________________
+// Kills the tracks created out of the envelope of the modules which can not reach
+// it, saving their kinetic energy as escaped energy. The positrons are kept, since
+// their annihilation photons can go back to the modules. Sends the secondary tracks
+// with energy above the threshold to the other threads. They are grouped until the
+// energy of the sub-event is reached. If the stack is full, the track is saved out
+// of it, unless the maximum number of saved tracks has been reached.
+G4ClassificationOfNewTrack EMCalStackingAction::ClassifyNewTrack( const G4Track *track ) {
+
+  if ( fKillEscaping && track -> GetKineticEnergy() > 0. &&
+       track -> GetDefinition() != G4Positron::Definition() &&
+       !fDetector -> ReachesEnvelope( track -> GetPosition(), track -> GetMomentumDirection() ) ) {
+    fRun -> AddEscapedEnergy( track -> GetKineticEnergy() );
+    return fKill;
+  }
+
+  if ( fOffloading && track -> GetParentID() != 0 && track -> GetKineticEnergy() >= fMinEnergy ) {
+
+    if ( !fSubEvent )
+      fSubEvent = new EMCalSubEvent( fOwner, fEventNumber, fNsubEvents++,
+				     fPrimaryOrigin, fPrimaryDirection );
+
+    fSubEvent -> AddTrack( track );
+
+    if ( fSubEvent -> GetEnergy() >= fSubEventEnergy ) {
+      fScheduler -> Submit( fSubEvent );
+      fSubEvent = 0;
+    }
+
+    return fKill;
+  }
+
+  G4ClassificationOfNewTrack classification = fUrgent;
+  if ( fMaxTracks > 0 && !fRestoring &&
+       size_t( stackManager -> GetNUrgentTrack() ) >= fMaxTracks ) {
+
+    if ( fMaxSaved == 0 || fOverflow.size() < fMaxSaved ) {
+      this -> SaveTrack( track );
+      classification = fKill;
+    }
+    else if ( !fSavedFull ) {
+      G4cout << "WARNING: The maximum number of saved tracks ( " << fMaxSaved
+	     << " ) has been reached. The new tracks stay in the stack." << G4endl;
+      fSavedFull = true;
+    }
+  }
+
+  fRun -> UpdateStackPeak( stackManager -> GetNTotalTrack() + ( classification == fUrgent ),
+			   fOverflow.size() );
+
+  return classification;
+}
+
+//_______________________________________________________________________________
+// Deletes the sub-events taken back from the scheduler which have not been processed
+void EMCalStackingAction::ClearReclaimed() {
+
+  for ( size_t isub = 0; isub < fReclaimed.size(); isub++ )
+    delete fReclaimed[ isub ];
+  fReclaimed.clear();
+}
+
+//_______________________________________________________________________________
+// Called when the urgent stack is empty. The tracks which have not been taken by
+// other threads are processed by this one, and no more tracks are sent in this
+// event. If the stack is still empty, the tracks saved out of it are stacked again.
+// The sub-events taken back are then stacked one at a time, seeding the random
+// engine as if they were processed by another thread, so the result does not
+// depend on which thread processes them.
+void EMCalStackingAction::NewStage() {
+
+  if ( fOffloading ) {
+
+    fOffloading = false;
+
+    if ( fSubEvent ) {
+      fSubEvent -> PushTracks( stackManager );
+      delete fSubEvent;
+      fSubEvent = 0;
+    }
+
+    fReclaimed = fScheduler -> Reclaim( fOwner );
+    std::sort( fReclaimed.begin(), fReclaimed.end(), LaterSubEvent );
+  }
+
+  if ( stackManager -> GetNUrgentTrack() != 0 )
+    return;
+
+  if ( !fOverflow.empty() )
+    this -> RestoreTracks();
+  else if ( !fReclaimed.empty() ) {
+    fReclaimed.back() -> SeedRandom();
+    fReclaimed.back() -> PushTracks( stackManager );
+    delete fReclaimed.back();
+    fReclaimed.pop_back();
+  }
+}
+
+//_______________________________________________________________________________
+// Decides whether the tracks of the new event are sent to other threads. The
+// sub-events are not divided again, and only the energy in the modules is added
+// back to the event, so they are not used if the pulses, the sub-cells or the steps
+// are written.
+void EMCalStackingAction::PrepareNewEvent() {
+
+  delete fSubEvent;
+  fSubEvent = 0;
+  this -> ClearReclaimed();
+
+  fOverflow.clear();
+  fSavedFull = false;
+
+  fRun = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> GetNonConstCurrentRun() );
+
+  fKillEscaping = fDetector -> KillingEscaping();
+
+  fOffloading = false;
+  if ( !fScheduler || !fScheduler -> Enabled() || EMCalSubEvent::GetCurrent() )
+    return;
+
+  if ( fRun -> PulsesEnabled() || fRun -> SegmentationEnabled() || fRun -> RecordingSteps() )
+    return;
+
+  fOffloading     = true;
+  fMinEnergy      = fScheduler -> GetMinEnergy();
+  fNsubEvents     = 0;
+  fEventNumber    = EMCalRunAction::GetEventNumber
+    ( G4EventManager::GetEventManager() -> GetConstCurrentEvent() -> GetEventID() );
+  fSubEventEnergy = fScheduler -> GetSubEventEnergy();
+
+  // The shower profiles of the sub-events are filled with respect to the axis of
+  // the primary particle of the event
+  const G4PrimaryVertex *vertex =
+    G4EventManager::GetEventManager() -> GetConstCurrentEvent() -> GetPrimaryVertex();
+  fPrimaryOrigin    = vertex -> GetPosition();
+  fPrimaryDirection = vertex -> GetPrimary() -> GetMomentumDirection();
+}
+
+//_______________________________________________________________________________
+// Stacks again as many saved tracks as the stack can hold. They are pushed in
+// reverse order, so the first one to be restored is the first one processed.
+void EMCalStackingAction::RestoreTracks() {
+
+  size_t ntracks = fMaxTracks > 0 ? std::min( fMaxTracks, fOverflow.size() ) : fOverflow.size();
+
+  std::vector<EMCalSubEvent::Track> tracks;
+  tracks.reserve( ntracks );
+
+  for ( size_t itrk = 0; itrk < ntracks; itrk++ ) {
+    if ( fOrder == kEnergy )
+      std::pop_heap( fOverflow.begin(), fOverflow.end(), MoreEnergetic );
+    tracks.push_back( fOverflow.back() );
+    fOverflow.pop_back();
+  }
+
+  fRestoring = true;
+  for ( size_t itrk = ntracks; itrk > 0; itrk-- )
+    stackManager -> PushOneTrack( EMCalSubEvent::MakeTrack( tracks[ itrk - 1 ] ) );
+  fRestoring = false;
+}
+
+//_______________________________________________________________________________
+// Saves a track out of the stack. If the tracks with less energy are stacked first,
+// they are kept in a heap.
+void EMCalStackingAction::SaveTrack( const G4Track *track ) {
+
+  fOverflow.push_back( EMCalSubEvent::SaveTrack( track ) );
+
+  if ( fOrder == kEnergy )
+    std::push_heap( fOverflow.begin(), fOverflow.end(), MoreEnergetic );
+}
+
+//_______________________________________________________________________________
+// Sets the order to stack again the tracks saved out of the stack. With < depth >
+// the last tracks saved are the first, following the shower in depth, while with
+// < energy > the tracks with less energy are the first, since they produce fewer
+// secondaries.
+void EMCalStackingAction::SetOrder( G4String order ) {
+
+  if ( order == "depth" )
+    fOrder = kDepth;
+  else if ( order == "energy" )
+    fOrder = kEnergy;
+  else {
+    G4cout << "WARNING: Unknown order of the stack <" << order << ">" << G4endl;
+    return;
+  }
+
+  fOverflow.clear();
+  fSavedFull = false;
+
+  G4cout << " Order of the stack set to <" << order << ">" << G4endl;
+}
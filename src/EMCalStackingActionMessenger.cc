@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the StackingAction class, which has control of the  //
+//  maximum number of tracks in the stack and of the order to stack again the    //
+//  tracks above it.                                                             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalStackingActionMessenger.hh"
+
+//_______________________________________________________________________________
+// Constructor
+EMCalStackingActionMessenger::EMCalStackingActionMessenger( EMCalStackingAction *stackingAction ) :
+  fStackingAction( stackingAction ) {
+
+  fStackDir
+    = new G4UIdirectory( "/EMCal/stack/" );
+  fStackDir -> SetGuidance( "Stack control" );
+
+  fMaxTracksCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/stack/setMaxTracks", this );
+  fMaxTracksCmd
+    -> SetGuidance( "Set the maximum number of tracks in the stack of each thread" );
+  fMaxTracksCmd
+    -> SetGuidance( "The tracks above it are saved in a compact form. Zero means no limit." );
+  fMaxTracksCmd -> SetParameterName( "MaxTracks", false );
+  fMaxTracksCmd -> SetRange( "MaxTracks >= 0" );
+  fMaxTracksCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fMaxSavedCmd
+    = new G4UIcmdWithAnInteger( "/EMCal/stack/setMaxSaved", this );
+  fMaxSavedCmd
+    -> SetGuidance( "Set the maximum number of tracks saved out of the stack of each thread" );
+  fMaxSavedCmd
+    -> SetGuidance( "The tracks above it stay in the stack. Zero means no limit." );
+  fMaxSavedCmd -> SetParameterName( "MaxSaved", false );
+  fMaxSavedCmd -> SetRange( "MaxSaved >= 0" );
+  fMaxSavedCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+  fOrderCmd
+    = new G4UIcmdWithAString( "/EMCal/stack/setOrder", this );
+  fOrderCmd
+    -> SetGuidance( "Set the order to stack again the tracks saved out of the stack" );
+  fOrderCmd -> SetParameterName( "Order", false );
+  fOrderCmd -> SetCandidates( "depth energy" );
+  fOrderCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalStackingActionMessenger::~EMCalStackingActionMessenger() {
+
+  delete fStackDir;
+  delete fMaxTracksCmd;
+  delete fMaxSavedCmd;
+  delete fOrderCmd;
+}
+
+//_______________________________________________________________________________
+// Modifies one attribute of the StackingAction class
+void EMCalStackingActionMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
+
+  if ( command == fMaxTracksCmd )
+    fStackingAction -> SetMaxTracks( fMaxTracksCmd -> GetNewIntValue( value ) );
+  else if ( command == fMaxSavedCmd )
+    fStackingAction -> SetMaxSaved( fMaxSavedCmd -> GetNewIntValue( value ) );
+  else if ( command == fOrderCmd )
+    fStackingAction -> SetOrder( value );
+}
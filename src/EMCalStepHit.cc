@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the StepHit class. Each step hit contains the information of one     //
+//  step that deposited energy in a module ( position in the frame of the volume,//
+//  time, energy and particle ), so the response of the detector can be computed //
+//  again without simulating the showers. The hits are allocated from a pool of  //
+//  each thread.                                                                 //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalStepHit.hh"
+
+
+//_______________________________________________________________________________
+// Allocator of the step hits ( one per thread )
+G4ThreadLocal G4Allocator<EMCalStepHit> *EMCalStepHitAllocator = 0;
+
+//_______________________________________________________________________________
+// Constructor
+EMCalStepHit::EMCalStepHit( G4int                                 module,
+			    EMCalDetectorConstruction::VolumeType type,
+			    const G4ThreeVector                  &position,
+			    G4double                              time,
+			    G4double                              energy,
+			    G4int                                 pdg ) :
+  G4VHit(),
+  fEnergy( energy ),
+  fLocalPosition( position ),
+  fModule( module ),
+  fPDG( pdg ),
+  fTime( time ),
+  fType( type ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalStepHit::~EMCalStepHit() { }
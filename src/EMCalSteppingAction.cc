@@ -26,65 +26,141 @@
 #include "G4Event.hh"
 #include "G4RunManager.hh"
 #include "G4LogicalVolume.hh"
+#include "G4Positron.hh"
 
 
 //_______________________________________________________________________________
-// Constructor
+// Constructor. The detector construction is shared by all the threads and it is
+// not replaced during the execution, so its pointer is cached here.
 EMCalSteppingAction::EMCalSteppingAction( EMCalEventAction* eventAction ) :
-  G4UserSteppingAction(), fEventAction( eventAction ) { }
+  G4UserSteppingAction(),
+  fSingleDetector( 0 ),
+  fSingleSGVolume( 0 ),
+  fEventAction( eventAction ),
+  fKernel( &EMCalSteppingAction::Score<true, true, false> ),
+  fKillEscaping( false ) {
+
+  fDetector = static_cast<const EMCalDetectorConstruction*>
+    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+}
 
 //_______________________________________________________________________________
 // Destructor
 EMCalSteppingAction::~EMCalSteppingAction() { }
 
 //_______________________________________________________________________________
-// Functions to perform each step
-void EMCalSteppingAction::UserSteppingAction( const G4Step* step ) {
+// Kills the track if it is out of the envelope of the modules at the end of the step
+// and it can not reach it again, saving its kinetic energy as escaped energy. The
+// tracks which have stopped are kept, since their products can go in any direction.
+// The positrons are never killed: one of the two photons of their annihilation goes
+// back along their path, and their rest mass would not be in the kinetic energy.
+void EMCalSteppingAction::KillEscaping( const G4Step *step ) {
 
-  // Gets the detector
-  const EMCalDetectorConstruction* detector
-    = static_cast<const EMCalDetectorConstruction*>
-    ( G4RunManager::GetRunManager() -> GetUserDetectorConstruction() );
+  G4Track *track = step -> GetTrack();
+  if ( track -> GetTrackStatus() != fAlive ||
+       track -> GetDefinition() == G4Positron::Definition() )
+    return;
+
+  const G4StepPoint *point = step -> GetPostStepPoint();
+  if ( fDetector -> ReachesEnvelope( point -> GetPosition(), point -> GetMomentumDirection() ) )
+    return;
+
+  fEventAction -> GetRun() -> AddEscapedEnergy( track -> GetKineticEnergy() );
+  track -> SetTrackStatus( fStopAndKill );
+}
+
+//_______________________________________________________________________________
+// Returns the kernel for the configuration of the geometry, with or without the
+// options of the steps
+template<G4bool options>
+EMCalSteppingAction::ScoringKernel EMCalSteppingAction::SelectGeometry( G4bool sgv,
+									G4bool grid ) {
+  if ( sgv )
+    return grid ?
+      &EMCalSteppingAction::Score<true, true, options> :
+      &EMCalSteppingAction::Score<true, false, options>;
+  else
+    return grid ?
+      &EMCalSteppingAction::Score<false, true, options> :
+      &EMCalSteppingAction::Score<false, false, options>;
+}
+
+//_______________________________________________________________________________
+// Selects the kernel to score the steps, given whether the shower-generator
+// volumes are enabled, whether there is more than one module and whether the run
+// applies any option to the steps. With a single module its volumes are compared
+// directly, so the volume table is not accessed. If the energy is scored by the
+// sensitive detectors there is no kernel, and the steps only go through this class
+// to kill the tracks escaping the modules.
+void EMCalSteppingAction::SelectKernel( G4bool sgv, G4bool grid, G4bool options ) {
+
+  fSingleDetector = fDetector -> GetDetector( 0 );
+  fSingleSGVolume = sgv ? fDetector -> GetSGVolume( 0 ) : 0;
+  fKillEscaping   = fDetector -> KillingEscaping();
+
+  if ( fDetector -> GetScoringMode() == EMCalDetectorConstruction::kSensitiveDetector )
+    fKernel = 0;
+  else if ( options )
+    fKernel = SelectGeometry<true>( sgv, grid );
+  else
+    fKernel = SelectGeometry<false>( sgv, grid );
+}
+
+//_______________________________________________________________________________
+// Scores the energy deposited in the step. The configuration of the geometry, and
+// whether any option is applied to the steps, are given as template parameters, so
+// the checks on them are resolved at compile time.
+template<G4bool sgv, G4bool grid, G4bool options>
+void EMCalSteppingAction::Score( const G4Step *step ) {
 
   // Gets the volume associated with the current step
-  G4LogicalVolume *volume 
+  const G4LogicalVolume *volume 
     = step -> GetPreStepPoint() -> GetTouchableHandle()
       -> GetVolume() -> GetLogicalVolume();
-      
-  // Gets the EMCalRun class
-  EMCalRun *run 
-    = static_cast<EMCalRun*>( G4RunManager::GetRunManager() -> 
-			      GetNonConstCurrentRun() );
-
-  // Checks if we are in scoring volume and if true it gets the energy deposited
-  size_t
-    imod,
-    size = detector -> GetNmodules();
-  G4bool
-    indetector = false,
-    insgvolume = false;
-  G4double edepStep;
-
-  imod = 0;
-  while ( imod < size && !indetector ) {
-    if ( volume == detector -> GetDetector( imod ) ) indetector = true;
-    imod++;
-  }
-  if ( indetector ) {
-    edepStep = step -> GetTotalEnergyDeposit();
-    // Because of the < while > loop < imod > is one unit greater
-    run -> AddEnergyToDetector( edepStep, imod - 1 );
+
+  // Gets the module and the role of the volume. With only one module the volume is
+  // compared with its scoring volumes, otherwise the volume table is used.
+  G4int                                 module;
+  EMCalDetectorConstruction::VolumeType type;
+  if ( grid ) {
+    const EMCalDetectorConstruction::VolumeInfo &info = fDetector -> GetVolumeInfo( volume );
+    module = info.Module;
+    type   = info.Type;
   }
-  else if ( detector -> SGVenabled() ) {
-    imod = 0;
-    while ( imod < size && !insgvolume ) {
-      if ( volume == detector -> GetSGVolume( imod ) ) insgvolume = true;
-      imod++;
-    }
-    if ( insgvolume ) {
-      edepStep = step -> GetTotalEnergyDeposit();
-      // Because of the < while > loop < imod > is one unit greater
-      run -> AddEnergyToSGVolume( edepStep, imod - 1 );
-    }
+  else {
+    module = 0;
+    if ( volume == fSingleDetector )
+      type = EMCalDetectorConstruction::kDetector;
+    else if ( sgv && volume == fSingleSGVolume )
+      type = EMCalDetectorConstruction::kSGVolume;
+    else
+      type = EMCalDetectorConstruction::kOutside;
   }
+
+  // If it is a scoring volume the energy deposited is added to the run of this thread
+  EMCalRun *run = fEventAction -> GetRun();
+  if ( type == EMCalDetectorConstruction::kDetector )
+    run -> AddEnergyToDetector( step -> GetTotalEnergyDeposit(), module );
+  else if ( sgv && type == EMCalDetectorConstruction::kSGVolume )
+    run -> AddEnergyToSGVolume( step -> GetTotalEnergyDeposit(), module );
+  else
+    return;
+
+  // The step is also added to the pulse of the module, quenched, added to the readout
+  // sub-cells, stored and added to the shower profiles, through the options enabled in
+  // the run. Without options the kernel does not check them.
+  if ( options )
+    run -> ScoreStepOptions( step, module, type );
+}
+
+//_______________________________________________________________________________
+// Functions to perform each step
+void EMCalSteppingAction::UserSteppingAction( const G4Step* step ) {
+
+  // Calls the kernel selected at the beginning of the run
+  if ( fKernel )
+    ( this ->* fKernel )( step );
+
+  if ( fKillEscaping )
+    this -> KillEscaping( step );
 }
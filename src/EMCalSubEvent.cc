@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SubEvent class. It holds a group of secondary tracks of an event //
+//  which are simulated by another worker thread, so the tracks of an event with //
+//  a large energy are shared among the threads. The thread processing the sub-  //
+//  event converts the tracks into primary particles, and saves the energy       //
+//  deposited in the modules, which is added to that of the event before it is   //
+//  filled.                                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalPrimaryGeneratorAction.hh"
+#include "EMCalRunAction.hh"
+#include "EMCalSubEvent.hh"
+
+#include "G4DynamicParticle.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+
+
+//_______________________________________________________________________________
+// Sub-event being processed by each thread
+G4ThreadLocal EMCalSubEvent *EMCalSubEvent::fCurrent = 0;
+
+//_______________________________________________________________________________
+// Constructor. The axis of the primary particle of the event is kept, since the
+// shower profiles are filled with respect to it, and so are its number and the index
+// of the sub-event, which give the seeds of the sub-event.
+EMCalSubEvent::EMCalSubEvent( G4int                owner,
+			      G4int                evtNb,
+			      G4int                index,
+			      const G4ThreeVector &origin,
+			      const G4ThreeVector &direction ) :
+  fCpuTime( 0 ),
+  fDone( false ),
+  fEnergy( 0 ),
+  fEscapedEnergy( 0 ),
+  fEventNumber( evtNb ),
+  fIndex( index ),
+  fOwner( owner ),
+  fPrimaryDirection( direction ),
+  fPrimaryOrigin( origin ),
+  fQuenchedEnergy( 0 ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalSubEvent::~EMCalSubEvent() { }
+
+//_______________________________________________________________________________
+// Saves the energy deposited by the sub-event in the module at position < idet >
+void EMCalSubEvent::AddModule( size_t   idet,
+			       G4double detectorEnergy,
+			       G4double sgvEnergy,
+			       G4int    ndet,
+			       G4int    nsgv ) {
+
+  Module module;
+  module.Index            = idet;
+  module.DetectorEnergy   = detectorEnergy;
+  module.SGVolumeEnergy   = sgvEnergy;
+  module.nDetInteractions = ndet;
+  module.nSgvInteractions = nsgv;
+
+  fModules.push_back( module );
+}
+
+//_______________________________________________________________________________
+// Adds a track to the sub-event, saving its state at creation
+void EMCalSubEvent::AddTrack( const G4Track *track ) {
+
+  fTracks.push_back( SaveTrack( track ) );
+
+  fEnergy += fTracks.back().Energy;
+}
+
+//_______________________________________________________________________________
+// Creates the event to be processed by a worker thread, with a primary vertex for
+// each track
+G4Event* EMCalSubEvent::BuildEvent( G4int eventID ) const {
+
+  G4Event *event = new G4Event( eventID );
+
+  for ( size_t itrk = 0; itrk < fTracks.size(); itrk++ ) {
+
+    const Track &state = fTracks[ itrk ];
+
+    G4PrimaryParticle *particle = new G4PrimaryParticle( state.Particle );
+    particle -> SetKineticEnergy( state.Energy );
+    particle -> SetMomentumDirection( state.Direction );
+    particle -> SetPolarization( state.Polarization );
+    particle -> SetWeight( state.Weight );
+
+    G4PrimaryVertex *vertex = new G4PrimaryVertex( state.Position, state.Time );
+    vertex -> SetPrimary( particle );
+
+    event -> AddPrimaryVertex( vertex );
+  }
+
+  return event;
+}
+
+//_______________________________________________________________________________
+// Creates a new track from the state saved when it was created
+G4Track* EMCalSubEvent::MakeTrack( const Track &state ) {
+
+  G4Track *track = new G4Track( new G4DynamicParticle( state.Particle,
+						       state.Direction,
+						       state.Energy ),
+				state.Time,
+				state.Position );
+  track -> SetTrackID( state.TrackID );
+  track -> SetParentID( state.ParentID );
+  track -> SetPolarization( state.Polarization );
+  track -> SetWeight( state.Weight );
+
+  return track;
+}
+
+//_______________________________________________________________________________
+// Gives back the tracks to the stack of the thread which created them, if no other
+// thread has processed the sub-event
+void EMCalSubEvent::PushTracks( G4StackManager *stackManager ) const {
+
+  for ( size_t itrk = 0; itrk < fTracks.size(); itrk++ )
+    stackManager -> PushOneTrack( MakeTrack( fTracks[ itrk ] ) );
+}
+
+//_______________________________________________________________________________
+// Seeds the random engine of the current thread from the seed of the run, the
+// number of the event which created the sub-event and its index. The result of the
+// sub-event does not depend then on the thread processing it, nor on the events
+// processed before by that thread.
+void EMCalSubEvent::SeedRandom() const {
+
+  EMCalPrimaryGeneratorAction::SeedEvent( EMCalRunAction::GetRunSeed(), fEventNumber, fIndex );
+}
+
+//_______________________________________________________________________________
+// Returns the state of a new track, which only takes the memory needed to create it
+// again
+EMCalSubEvent::Track EMCalSubEvent::SaveTrack( const G4Track *track ) {
+
+  Track state;
+  state.Particle     = track -> GetParticleDefinition();
+  state.Energy       = track -> GetKineticEnergy();
+  state.Time         = track -> GetGlobalTime();
+  state.Weight       = track -> GetWeight();
+  state.Position     = track -> GetPosition();
+  state.Direction    = track -> GetMomentumDirection();
+  state.Polarization = track -> GetPolarization();
+  state.TrackID      = track -> GetTrackID();
+  state.ParentID     = track -> GetParentID();
+
+  return state;
+}
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the SubEventScheduler class. It shares the sub-events among the      //
+//  worker threads of the multithreaded run manager. A thread processing an event//
+//  with a large energy submits groups of its secondary tracks as sub-events,    //
+//  which are taken by the threads which have finished their own events. When the//
+//  thread has no more tracks, it takes back the sub-events which were not taken,//
+//  and waits for the rest before filling the event. Tracks are only sent to     //
+//  other threads if their energy is above the threshold set by the user, and    //
+//  they are grouped until their energy reaches the size of the sub-events.      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalSubEventScheduler.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+
+
+//_______________________________________________________________________________
+// Scheduler shared by all the threads
+EMCalSubEventScheduler *EMCalSubEventScheduler::fInstance = 0;
+
+//_______________________________________________________________________________
+// Constructor. The events are not divided by default.
+EMCalSubEventScheduler::EMCalSubEventScheduler() :
+  fMinEnergy( 0 ),
+  fSubEventEnergy( 1*GeV ),
+  fNactiveOwners( 0 ),
+  fNworkersWithEvents( 0 ),
+  fNprocessed( 0 ),
+  fNreclaimed( 0 ),
+  fNsubmitted( 0 ),
+  fNtracks( 0 ) {
+
+  fInstance = this;
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalSubEventScheduler::~EMCalSubEventScheduler() {
+
+  if ( fInstance == this )
+    fInstance = 0;
+}
+
+//_______________________________________________________________________________
+// Waits until all the sub-events submitted by the thread < owner > in its current
+// event have been processed, and returns them. The sub-events are owned by the
+// caller afterwards.
+std::vector<EMCalSubEvent*> EMCalSubEventScheduler::Collect( G4int owner ) {
+
+  std::vector<EMCalSubEvent*> subEvents;
+
+  // The flag of each thread is only modified by itself
+  if ( !fOwnerActive[ owner ] )
+    return subEvents;
+
+  std::unique_lock<std::mutex> lock( fMutex );
+
+  std::vector<EMCalSubEvent*> &submitted = fSubmitted[ owner ];
+  for ( size_t isub = 0; isub < submitted.size(); isub++ )
+    while ( !submitted[ isub ] -> IsDone() )
+      fCondition.wait( lock );
+
+  subEvents.swap( submitted );
+
+  fOwnerActive[ owner ] = 0;
+  fNactiveOwners--;
+
+  fCondition.notify_all();
+
+  return subEvents;
+}
+
+//_______________________________________________________________________________
+// Marks the sub-event as processed, waking the thread which submitted it
+void EMCalSubEventScheduler::Complete( EMCalSubEvent *subEvent ) {
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  subEvent -> SetDone();
+  fNprocessed++;
+
+  fCondition.notify_all();
+}
+
+//_______________________________________________________________________________
+// Called by each worker thread once it has no more events to process
+void EMCalSubEventScheduler::FinishEvents() {
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  fNworkersWithEvents--;
+
+  fCondition.notify_all();
+}
+
+//_______________________________________________________________________________
+// Returns the scheduler of the run manager. It is null if the run manager does not
+// divide the events.
+EMCalSubEventScheduler* EMCalSubEventScheduler::GetInstance() { return fInstance; }
+
+//_______________________________________________________________________________
+// Returns the next sub-event to be processed. If < wait > is true and there are no
+// sub-events, waits until one is submitted or no more can be submitted. Returns null
+// if there are no sub-events to process.
+EMCalSubEvent* EMCalSubEventScheduler::Next( G4bool wait ) {
+
+  std::unique_lock<std::mutex> lock( fMutex );
+
+  while ( fQueue.empty() ) {
+
+    if ( !wait || ( fNactiveOwners == 0 && fNworkersWithEvents == 0 ) )
+      return 0;
+
+    fCondition.wait( lock );
+  }
+
+  EMCalSubEvent *subEvent = fQueue.front();
+  fQueue.pop_front();
+
+  return subEvent;
+}
+
+//_______________________________________________________________________________
+// Prints the number of sub-events processed by other threads and taken back by the
+// threads which created them
+void EMCalSubEventScheduler::PrintStatistics() const {
+
+  if ( fNsubmitted == 0 )
+    return;
+
+  G4cout << "  Sub-events:        \t" << fNsubmitted << " ( " << fNtracks << " tracks )" << G4endl;
+  G4cout << "  Sub-events shared: \t" << fNprocessed << G4endl;
+  G4cout << "  Sub-events kept:   \t" << fNreclaimed << G4endl;
+}
+
+//_______________________________________________________________________________
+// Removes from the queue the sub-events of the thread < owner > which have not been
+// taken by other threads, and returns them. Their tracks must be processed by the
+// caller, which owns them.
+std::vector<EMCalSubEvent*> EMCalSubEventScheduler::Reclaim( G4int owner ) {
+
+  std::vector<EMCalSubEvent*> subEvents;
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  std::deque<EMCalSubEvent*>::iterator it = fQueue.begin();
+  while ( it != fQueue.end() )
+    if ( ( *it ) -> GetOwner() == owner ) {
+      subEvents.push_back( *it );
+      it = fQueue.erase( it );
+    }
+    else
+      ++it;
+
+  // The sub-events taken back are not waited for
+  std::vector<EMCalSubEvent*> &submitted = fSubmitted[ owner ];
+  for ( size_t isub = 0; isub < subEvents.size(); isub++ )
+    submitted.erase( std::find( submitted.begin(), submitted.end(), subEvents[ isub ] ) );
+
+  fNreclaimed += subEvents.size();
+
+  return subEvents;
+}
+
+//_______________________________________________________________________________
+// Prepares the scheduler for a new run processed by < nthreads > worker threads. It
+// is called by the master before the workers start.
+void EMCalSubEventScheduler::StartRun( G4int nthreads ) {
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  fQueue.clear();
+  fOwnerActive.assign( nthreads, 0 );
+  fSubmitted.assign( nthreads, std::vector<EMCalSubEvent*>() );
+  fNactiveOwners      = 0;
+  fNworkersWithEvents = nthreads;
+  fNprocessed         = 0;
+  fNreclaimed         = 0;
+  fNsubmitted         = 0;
+  fNtracks            = 0;
+}
+
+//_______________________________________________________________________________
+// Adds a sub-event to the queue. The thread which submits it keeps the ownership.
+void EMCalSubEventScheduler::Submit( EMCalSubEvent *subEvent ) {
+
+  std::lock_guard<std::mutex> lock( fMutex );
+
+  G4int owner = subEvent -> GetOwner();
+  if ( !fOwnerActive[ owner ] ) {
+    fOwnerActive[ owner ] = 1;
+    fNactiveOwners++;
+  }
+
+  fSubmitted[ owner ].push_back( subEvent );
+  fQueue.push_back( subEvent );
+
+  fNsubmitted++;
+  fNtracks += subEvent -> GetNtracks();
+
+  fCondition.notify_all();
+}
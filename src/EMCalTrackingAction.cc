@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the TrackingAction class. It adds the steps of each track to those of//
+//  the current event, which are given to the progress meter at the end of the   //
+//  event. They are counted once per track, so nothing is done at each step.     //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalTrackingAction.hh"
+#include "EMCalEventAction.hh"
+
+#include "G4Track.hh"
+
+
+//_______________________________________________________________________________
+// Constructor
+EMCalTrackingAction::EMCalTrackingAction( EMCalEventAction *eventAction ) :
+  G4UserTrackingAction(),
+  fEventAction( eventAction ) { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalTrackingAction::~EMCalTrackingAction() { }
+
+//_______________________________________________________________________________
+// Adds the steps of the track to the event when it is stopped or suspended
+void EMCalTrackingAction::PostUserTrackingAction( const G4Track *track ) {
+
+  fEventAction -> AddSteps( track -> GetCurrentStepNumber() );
+}
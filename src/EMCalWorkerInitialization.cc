@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerInitialization class. When a worker thread starts, it pins //
+//  it to the processors of the machine following the layout set by the user,    //
+//  taking into account the NUMA nodes read from the system. With < compact > the//
+//  workers fill the processors of a node before using the next one, with <      //
+//  scatter > they are distributed among the nodes, and with < node > each worker//
+//  can run on any processor of the node assigned to it. The structures of each  //
+//  thread are allocated and set to zero by the thread itself once it is pinned, //
+//  so the memory is placed in its node. The layout can also be given through the//
+//  environment variable EMCAL_PINNING.                                          //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalWorkerInitialization.hh"
+#include "EMCalWorkerInitializationMessenger.hh"
+
+#include "G4Threading.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+//_______________________________________________________________________________
+// Returns the processors in a list with the format used by the system, where the
+// ranges are separated by commas ( 0-3,8-11 )
+static std::vector<G4int> ParseCpuList( const std::string &list ) {
+
+  std::vector<G4int> cpus;
+
+  std::stringstream stream( list );
+  std::string       range;
+  while ( std::getline( stream, range, ',' ) ) {
+
+    if ( range.empty() )
+      continue;
+
+    size_t dash  = range.find( '-' );
+    G4int  first = std::atoi( range.substr( 0, dash ).data() );
+    G4int  last  = dash == std::string::npos ? first : std::atoi( range.substr( dash + 1 ).data() );
+
+    for ( G4int cpu = first; cpu <= last; cpu++ )
+      cpus.push_back( cpu );
+  }
+
+  return cpus;
+}
+
+//_______________________________________________________________________________
+// Constructor. The layout is taken from the environment, if it is set.
+EMCalWorkerInitialization::EMCalWorkerInitialization() :
+  G4UserWorkerInitialization(), fPinning( "none" ) {
+
+  fMessenger = new EMCalWorkerInitializationMessenger( this );
+
+  this -> ReadTopology();
+
+  const char *pinning = std::getenv( "EMCAL_PINNING" );
+  if ( pinning )
+    this -> SetPinning( pinning );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalWorkerInitialization::~EMCalWorkerInitialization() { delete fMessenger; }
+
+//_______________________________________________________________________________
+// Reads the processors of each NUMA node. Only the processors where the program is
+// allowed to run are kept. If the nodes can not be read, all the processors are
+// considered to be in the same node.
+void EMCalWorkerInitialization::ReadTopology() {
+
+  fNodes.clear();
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO( &allowed );
+  if ( sched_getaffinity( 0, sizeof( allowed ), &allowed ) )
+    return;
+
+  for ( G4int inode = 0; inode < 256; inode++ ) {
+
+    std::stringstream path;
+    path << "/sys/devices/system/node/node" << inode << "/cpulist";
+
+    std::ifstream file( path.str().data() );
+    std::string   list;
+    if ( !file || !std::getline( file, list ) )
+      continue;
+
+    std::vector<G4int> cpus = ParseCpuList( list ), node;
+    for ( size_t icpu = 0; icpu < cpus.size(); icpu++ )
+      if ( cpus[ icpu ] < CPU_SETSIZE && CPU_ISSET( cpus[ icpu ], &allowed ) )
+	node.push_back( cpus[ icpu ] );
+
+    if ( !node.empty() )
+      fNodes.push_back( node );
+  }
+
+  if ( fNodes.empty() ) {
+    std::vector<G4int> node;
+    for ( G4int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+      if ( CPU_ISSET( cpu, &allowed ) )
+	node.push_back( cpu );
+    fNodes.push_back( node );
+  }
+#endif
+}
+
+//_______________________________________________________________________________
+// Sets the layout used to pin the threads
+void EMCalWorkerInitialization::SetPinning( G4String layout ) {
+
+  if ( layout != "none" && layout != "compact" && layout != "scatter" && layout != "node" ) {
+    G4cout << "WARNING: Pinning layout <" << layout << "> not known" << G4endl;
+    return;
+  }
+
+#ifndef __linux__
+  if ( layout != "none" )
+    G4cout << "WARNING: The threads can only be pinned in Linux" << G4endl;
+#endif
+
+  fPinning = layout;
+
+  G4cout << " Pinning of the worker threads set to <" << layout << "> with "
+	 << fNodes.size() << " NUMA nodes" << G4endl;
+}
+
+//_______________________________________________________________________________
+// Pins the thread which is starting to the processors given by the layout. It is
+// called before the thread builds its copies of the geometry and physics, its run
+// manager and its actions, so their memory is placed in the node where it runs.
+void EMCalWorkerInitialization::WorkerInitialize() const {
+
+  if ( fPinning == "none" || fNodes.empty() )
+    return;
+
+#ifdef __linux__
+  size_t id     = G4Threading::G4GetThreadId();
+  size_t nnodes = fNodes.size();
+
+  std::vector<G4int> cpus;
+  if ( fPinning == "node" )
+    cpus = fNodes[ id % nnodes ];
+  else if ( fPinning == "scatter" ) {
+    const std::vector<G4int> &node = fNodes[ id % nnodes ];
+    cpus.push_back( node[ ( id/nnodes ) % node.size() ] );
+  }
+  else {
+    std::vector<G4int> all;
+    for ( size_t inode = 0; inode < nnodes; inode++ )
+      all.insert( all.end(), fNodes[ inode ].begin(), fNodes[ inode ].end() );
+    cpus.push_back( all[ id % all.size() ] );
+  }
+
+  cpu_set_t mask;
+  CPU_ZERO( &mask );
+  for ( size_t icpu = 0; icpu < cpus.size(); icpu++ )
+    CPU_SET( cpus[ icpu ], &mask );
+
+  if ( pthread_setaffinity_np( pthread_self(), sizeof( mask ), &mask ) ) {
+    G4cout << "WARNING: Unable to pin the worker thread " << id << G4endl;
+    return;
+  }
+
+  G4cout << " Worker thread " << id << " pinned to " << cpus.size()
+	 << " processors starting at " << cpus.front() << G4endl;
+#endif
+}
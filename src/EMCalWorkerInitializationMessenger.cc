@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the messenger of the WorkerInitialization class, to set the layout   //
+//  used to pin the worker threads to the processors.                            //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#include "EMCalWorkerInitializationMessenger.hh"
+
+//_______________________________________________________________________________
+// Constructor. The commands only concern the master, so they are not broadcast to
+// the workers.
+EMCalWorkerInitializationMessenger::EMCalWorkerInitializationMessenger
+( EMCalWorkerInitialization *workerInit ) : fWorkerInit( workerInit ) {
+
+  fThreadsDir = new G4UIdirectory( "/EMCal/threads/", false );
+  fThreadsDir -> SetGuidance( "Control of the worker threads" );
+
+  fPinningCmd
+    = new G4UIcmdWithAString( "/EMCal/threads/setPinning", this );
+  fPinningCmd -> SetGuidance( "Layout used to pin the worker threads to the processors." );
+  fPinningCmd -> SetGuidance( "  none:    the threads are not pinned" );
+  fPinningCmd -> SetGuidance( "  compact: the processors of each NUMA node are filled in turn" );
+  fPinningCmd -> SetGuidance( "  scatter: the threads are distributed among the NUMA nodes" );
+  fPinningCmd -> SetGuidance( "  node:    each thread runs on any processor of its NUMA node" );
+  fPinningCmd -> SetGuidance( "It must be set before the threads are started." );
+  fPinningCmd -> SetParameterName( "Pinning", false );
+  fPinningCmd -> SetCandidates( "none compact scatter node" );
+  fPinningCmd -> SetDefaultValue( "none" );
+  fPinningCmd -> SetToBeBroadcasted( false );
+  fPinningCmd -> AvailableForStates( G4State_PreInit, G4State_Idle );
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalWorkerInitializationMessenger::~EMCalWorkerInitializationMessenger() {
+
+  delete fThreadsDir;
+  delete fPinningCmd;
+}
+
+//_______________________________________________________________________________
+// Modifies one attribute of the WorkerInitialization class
+void EMCalWorkerInitializationMessenger::SetNewValue( G4UIcommand *command, G4String value ) {
+
+  if ( command == fPinningCmd )
+    fWorkerInit -> SetPinning( value );
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerRunManager class. It is the run manager of each worker     //
+//  thread of the multithreaded run manager. Besides the events given by the     //
+//  master, it processes the sub-events submitted by the other workers. These    //
+//  have priority over new events, so the events which created them finish       //
+//  earlier, and once the worker has no more events it waits for new sub-events  //
+//  until all the workers have finished.                                         //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#include "EMCalWorkerRunManager.hh"
+
+
+//_______________________________________________________________________________
+// Constructor. The scheduler is owned by the master run manager.
+EMCalWorkerRunManager::EMCalWorkerRunManager() :
+  G4WorkerRunManager(),
+  fHasEvents( false ),
+  fNsubEvents( 0 ) {
+
+  fScheduler = EMCalSubEventScheduler::GetInstance();
+}
+
+//_______________________________________________________________________________
+// Destructor
+EMCalWorkerRunManager::~EMCalWorkerRunManager() { }
+
+//_______________________________________________________________________________
+// Initializes the event loop of a new run
+void EMCalWorkerRunManager::InitializeEventLoop( G4int       n_event,
+						 const char *macroFile,
+						 G4int       n_select ) {
+  fHasEvents  = true;
+  fNsubEvents = 0;
+
+  G4WorkerRunManager::InitializeEventLoop( n_event, macroFile, n_select );
+}
+
+//_______________________________________________________________________________
+// Generates the next event to be processed. If the events are divided, the
+// sub-events of the other workers are processed first. Once the events given by the
+// master are finished, the worker waits for the sub-events of the rest.
+G4Event* EMCalWorkerRunManager::GenerateEvent( G4int i_event ) {
+
+  EMCalSubEvent::SetCurrent( 0 );
+
+  if ( !fScheduler || !fScheduler -> Enabled() )
+    return G4WorkerRunManager::GenerateEvent( i_event );
+
+  EMCalSubEvent *subEvent = fScheduler -> Next( false );
+
+  if ( !subEvent && fHasEvents ) {
+
+    G4Event *event = G4WorkerRunManager::GenerateEvent( i_event );
+    if ( eventLoopOnGoing )
+      return event;
+
+    fHasEvents = false;
+    fScheduler -> FinishEvents();
+  }
+
+  if ( !subEvent )
+    subEvent = fScheduler -> Next( true );
+
+  if ( !subEvent ) {
+    eventLoopOnGoing = false;
+    return 0;
+  }
+
+  // The primary particles of the sub-event are the tracks sent by the other worker,
+  // so the primary generator is not called. The random engine is seeded from the
+  // event which created the sub-event, so the result does not depend on this thread.
+  eventLoopOnGoing = true;
+  EMCalSubEvent::SetCurrent( subEvent );
+  subEvent -> SeedRandom();
+
+  return subEvent -> BuildEvent( fNsubEvents++ );
+}
+
+#endif
@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////////
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  AUTHOR: Miguel Ramos Pernas                                                  //
+//  e-mail: miguel.ramos.pernas@cern.ch                                          //
+//                                                                               //
+//  Last update: 29/10/2015                                                      //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+//                                                                               //
+//  Description:                                                                 //
+//                                                                               //
+//  Defines the WorkerThreadInitialization class. It creates the run manager of  //
+//  each worker thread of the multithreaded run manager, which also processes the//
+//  sub-events of the other workers.                                             //
+//                                                                               //
+// ----------------------------------------------------------------------------- //
+///////////////////////////////////////////////////////////////////////////////////
+
+
+#ifdef G4MULTITHREADED
+
+#include "EMCalWorkerThreadInitialization.hh"
+#include "EMCalWorkerRunManager.hh"
+
+
+//_______________________________________________________________________________
+// Constructor
+EMCalWorkerThreadInitialization::EMCalWorkerThreadInitialization() :
+  G4UserWorkerThreadInitialization() { }
+
+//_______________________________________________________________________________
+// Destructor
+EMCalWorkerThreadInitialization::~EMCalWorkerThreadInitialization() { }
+
+//_______________________________________________________________________________
+// Creates the run manager of a worker thread
+G4WorkerRunManager* EMCalWorkerThreadInitialization::CreateWorkerRunManager() const {
+  return new EMCalWorkerRunManager;
+}
+
+#endif